@@ -0,0 +1,57 @@
+"""arith_compare.py  ─────────  expo_gen --family arithmetic vs question_generator.py
+
+Builds question i = generate_expression(random.Random(i)) for i in [0, N)
+with the Python script and with expo_gen (--seed 0 --range 0:N), checks
+that expression, answer and difficulty (rounded to 2 places, as
+rebuild_question reports it) agree for every i, and prints the
+throughput of both.
+
+    python3 arith_compare.py [--n N] [--expo-gen ./expo_gen] [--threads T]
+"""
+import argparse
+import json
+import random
+import subprocess
+import sys
+import time
+
+import question_generator as qg
+
+
+def main():
+    ap = argparse.ArgumentParser()
+    ap.add_argument("--n", type=int, default=200_000)
+    ap.add_argument("--expo-gen", default="./expo_gen")
+    ap.add_argument("--threads", type=int, default=1)
+    args = ap.parse_args()
+
+    t0 = time.perf_counter()
+    py = [qg.generate_expression(random.Random(i)) for i in range(args.n)]
+    py_secs = time.perf_counter() - t0
+
+    t0 = time.perf_counter()
+    out = subprocess.run([args.expo_gen, "--family", "arithmetic", "--seed", "0",
+                          "--range", f"0:{args.n}", "--threads", str(args.threads)],
+                         check=True, capture_output=True, text=True).stdout
+    cpp_secs = time.perf_counter() - t0
+    cpp = [json.loads(line) for line in out.splitlines()]
+
+    if len(cpp) != len(py):
+        sys.exit(f"expo_gen wrote {len(cpp)} questions, expected {len(py)}")
+    bad = 0
+    for i, ((expr, ans, diff, _), rec) in enumerate(zip(py, cpp)):
+        if (rec["expression"], rec["answer"], rec["difficulty"]) != (expr, str(ans), round(diff, 2)):
+            bad += 1
+            if bad <= 10:
+                print(f"seed {i}: python {expr} = {ans} ({round(diff, 2)})  "
+                      f"expo_gen {rec['expression']} = {rec['answer']} ({rec['difficulty']})")
+
+    print(f"{args.n} questions, {bad} mismatches")
+    print(f"python    {py_secs:8.2f} s  {args.n / py_secs:12.0f} q/s")
+    print(f"expo_gen  {cpp_secs:8.2f} s  {args.n / cpp_secs:12.0f} q/s  "
+          f"({py_secs / cpp_secs:.0f}x, {args.threads} thread(s), process start and JSON parse included)")
+    sys.exit(1 if bad else 0)
+
+
+if __name__ == "__main__":
+    main()
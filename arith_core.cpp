@@ -0,0 +1,257 @@
+/*  arith_core.cpp  ─────────  the + - × ÷ question family
+    A port of question_generator.py: generate_expression() draw for draw
+    and its scorers (addition_difficulty, subtraction_difficulty,
+    compute_multiplication_difficulty, compute_full_division_difficulty)
+    value for value.  The draws come from PyRandom, a copy of CPython's
+    random.Random (MT19937, init_by_array seeding, getrandbits-based
+    randint / choice, 53-bit random()), so question i of seed 0 is what
+    the script builds from random.Random(i), and arith_compare.py can
+    check that exactly.  Linked into expo_gen (--family arithmetic).   */
+
+    #include "question_family.h"
+    #include "difficulty_kernels.h"
+    #include <array>
+    #include <cmath>
+    #include <cstdint>
+    #include <string>
+    #include <vector>
+
+    using namespace expo::detail;
+
+    namespace arith {
+
+    /*───────────────────────────────────────────────────────────────────*/
+    /*  1.  CPython's random.Random                                      */
+    /*  Seeding dominates a question (a few dozen draws follow), so the
+        init_genrand(19650218) state init_by_array starts from is built at
+        compile time, and the state is twisted one word per draw instead
+        of all 624 at once: word k only reads words k+1 (not yet twisted)
+        and k+397 mod 624 (twisted already iff it wrapped), exactly what
+        the in-place batch twist reads at step k.                       */
+    class PyRandom{
+        static constexpr int N = 624, M = 397;
+        using State = std::array<std::uint32_t,N>;
+        static constexpr State genrand_19650218 = []{
+            State mt{};
+            mt[0] = 19650218u;
+            for(int i=1;i<N;++i) mt[i] = 1812433253u*(mt[i-1]^(mt[i-1]>>30)) + (std::uint32_t)i;
+            return mt;
+        }();
+        State mt_;
+        int mti_ = 0;
+
+        /* random_seed(): init_by_array over the seed's 32-bit words */
+        void init_by_array(const std::uint32_t* key, int len){
+            mt_ = genrand_19650218;
+            int i=1, j=0;
+            for(int k = N>len? N : len; k; --k){
+                mt_[i] = (mt_[i]^((mt_[i-1]^(mt_[i-1]>>30))*1664525u)) + key[j] + (std::uint32_t)j;
+                ++i; ++j;
+                if(i>=N){ mt_[0] = mt_[N-1]; i = 1; }
+                if(j>=len) j = 0;
+            }
+            for(int k=N-1;k;--k){
+                mt_[i] = (mt_[i]^((mt_[i-1]^(mt_[i-1]>>30))*1566083941u)) - (std::uint32_t)i;
+                if(++i>=N){ mt_[0] = mt_[N-1]; i = 1; }
+            }
+            mt_[0] = 0x80000000u;
+            mti_ = 0;
+        }
+        std::uint32_t genrand(){
+            int k = mti_, k1 = k+1<N? k+1 : 0, km = k+M<N? k+M : k+M-N;
+            std::uint32_t y = (mt_[k]&0x80000000u) | (mt_[k1]&0x7fffffffu);
+            mt_[k] = mt_[km] ^ (y>>1) ^ ((y&1u)? 0x9908b0dfu : 0u);
+            mti_ = k1;
+            y = mt_[k];
+            y ^= y>>11;  y ^= (y<<7)&0x9d2c5680u;  y ^= (y<<15)&0xefc60000u;
+            return y ^ (y>>18);
+        }
+        /* _randbelow_with_getrandbits, for n < 2^32 */
+        std::uint32_t below(std::uint32_t n){
+            int k = 32 - __builtin_clz(n);
+            std::uint32_t r;
+            do r = genrand()>>(32-k); while(r>=n);
+            return r;
+        }
+    public:
+        /* random.Random(hi·2^64 + lo) */
+        explicit PyRandom(std::uint64_t lo, std::uint64_t hi = 0){
+            std::uint32_t key[4] = { (std::uint32_t)lo, (std::uint32_t)(lo>>32),
+                                     (std::uint32_t)hi, (std::uint32_t)(hi>>32) };
+            int len = 4;
+            while(len>1 && !key[len-1]) --len;
+            init_by_array(key, len);
+        }
+        long long randint(long long a, long long b){ return a + below((std::uint32_t)(b-a+1)); }
+        template<class T, std::size_t K>
+        const T& choice(const std::array<T,K>& v){ return v[below(K)]; }
+        template<class T>
+        const T& choice(const std::vector<T>& v){ return v[below((std::uint32_t)v.size())]; }
+        double random(){
+            std::uint32_t a = genrand()>>5, b = genrand()>>6;
+            return (a*67108864.0 + b)*(1.0/9007199254740992.0);
+        }
+    };
+
+    /*───────────────────────────────────────────────────────────────────*/
+    /*  2.  compute_full_division_difficulty, in quarter points           */
+    /*  Long division chunk by chunk; each chunk is estimated with a
+        rounded "factor" of the divisor (its first digit, rounded on the
+        second, whatever its length) and then multiplied out from that
+        estimate.  Quirks kept: a chunk the estimate overshoots comes back
+        unchanged, and a small chunk of a small factor is taken as exact. */
+    constexpr long long get_factor(long long d){
+        if(d<10) return d;
+        long long lead = d;
+        while(lead>=100) lead /= 10;          // first two digits
+        return lead/10 + (lead%10>=5);
+    }
+    struct DivState{ int q = 0; bool factoring_used = false; };
+
+    constexpr long long handle_chunk(long long c, long long d, DivState& st){
+        if(c<d) return c;
+        if(!st.factoring_used){
+            if(d>9) st.q += 1;
+            st.factoring_used = true;
+        }
+        long long factor = get_factor(d);
+        if(c<10 && factor<10){ st.q += 2; return 0; }
+        if(factor<10 && c<=factor*10){ st.q += 4; return 0; }
+        long long m = c/factor > 1? c/factor : 1;
+        bool havePrev = false;  long long prev = 0;
+        while(true){
+            kern::MulQ mul = kern::mul_q(m, d);
+            st.q += mul.q;
+            if(mul.total==c) return 0;
+            if(mul.total<c){ havePrev = true;  prev = mul.total;  ++m;  continue; }
+            if(!havePrev) return c;
+            st.q += kern::sub_q(c, prev);
+            return c - prev;
+        }
+    }
+    constexpr int div_q(long long dividend, long long divisor){
+        DivState st;
+        long long rem = 0;
+        kern::Digits s = kern::digits(dividend);
+        for(int i=0;i<s.n;++i){
+            rem = rem*10 + s.d[i];
+            if(rem>=divisor) rem = handle_chunk(rem, divisor, st);
+        }
+        return st.q;
+    }
+
+    /*───────────────────────────────────────────────────────────────────*/
+    /*  3.  generate_expression                                          */
+    /* divisors of n in 2..n-1, ascending (get_divisors) */
+    void divisors(long long n, std::vector<long long>& out){
+        out.clear();
+        std::size_t mid = 0;
+        for(long long i=2;i*i<=n;++i){
+            if(n%i) continue;
+            out.insert(out.begin()+mid, i);  ++mid;
+            if(i*i!=n) out.insert(out.begin()+mid, n/i);
+        }
+    }
+
+    /* quarter points of one step `res op nxt` */
+    constexpr int step_q(char op, long long res, long long nxt){
+        switch(op){
+            case '+': return kern::add_q(res,nxt);
+            case '-': return kern::sub_q(res,nxt);
+            case '*': return kern::mul_q(res,nxt).q;
+            default:  return div_q(res,nxt);
+        }
+    }
+    /* a chain of k steps is scored 1.1^(k-1) times their sum */
+    const std::array<double,4> growth = {1.0, std::pow(1.1,1.0), std::pow(1.1,2.0), std::pow(1.1,3.0)};
+
+    Question generate_expression(PyRandom& rng){
+        static constexpr std::array<char,4> OPS = {'+','-','*','/'};
+        std::vector<long long> used, divs, cand;
+        auto isUsed = [&](long long v){ for(long long u: used) if(u==v) return true; return false; };
+        while(true){
+            long long res = rng.randint(1,100);
+            std::string expr = std::to_string(res);
+            bool hasAddSub = false;
+            int q = 0, ops = 0;
+            used.assign(1, res);
+
+            while(ops<4){
+                char op = rng.choice(OPS);
+                long long nxt;
+                if(op=='+') nxt = rng.randint(1,100);
+                else if(op=='-'){
+                    if(res==0) break;
+                    nxt = rng.randint(1,res);
+                }else if(op=='*'){
+                    do nxt = rng.randint(2,20); while(isUsed(nxt));
+                    used.push_back(nxt);
+                }else{
+                    divisors(res, divs);
+                    cand.clear();
+                    for(long long d: divs) if(!isUsed(d)) cand.push_back(d);
+                    if(cand.empty()) break;
+                    nxt = rng.choice(cand);
+                    used.push_back(nxt);
+                }
+
+                q += step_q(op, res, nxt);
+                switch(op){
+                    case '+': res += nxt;  break;
+                    case '-': res -= nxt;  break;
+                    case '*': res = kern::wrap_mul(res,nxt);  break;
+                    default:  res /= nxt;  break;
+                }
+                if((op=='*' || op=='/') && hasAddSub) expr = "(" + expr + ")";
+                expr += ' ';  expr += op;  expr += ' ';  expr += std::to_string(nxt);
+                hasAddSub |= (op=='+' || op=='-');
+                ++ops;
+                if(rng.random()>=0.4) break;
+            }
+
+            if(ops && q<=30*4){
+                Question out;
+                out.expr = std::move(expr);
+                out.ans = std::to_string(res);
+                out.difficulty = kern::to_diff(q) * growth[ops-1];
+                return out;
+            }
+        }
+    }
+
+    /*───────────────────────────────────────────────────────────────────*/
+    /*  4.  the family                                                   */
+    /*  Question i of seed s is random.Random(s·2^64 + i); with s = 0
+        that is question_generator.py's own seed i.                     */
+    class ArithmeticFamily final : public QuestionFamily{
+    public:
+        const char* name() const override { return "arithmetic"; }
+        Question draw(std::mt19937_64& rng) const override {
+            PyRandom py(rng());
+            return generate_expression(py);
+        }
+        Question at(std::uint64_t seed, std::uint64_t index) const override {
+            PyRandom py(index, seed);
+            return generate_expression(py);
+        }
+        /* the expression determines the rest; FNV-1a rather than
+           std::hash, whose values may change between builds, because
+           --index files keep keys                                      */
+        std::uint64_t key(const Question& q) const override { return arithmetic_key(q.expr); }
+    };
+
+    } // namespace arith
+
+    const QuestionFamily& arithmetic_family(){
+        static const arith::ArithmeticFamily f;
+        return f;
+    }
+    int arithmetic_step_q(char op, long long res, long long nxt){ return arith::step_q(op, res, nxt); }
+    double arithmetic_difficulty(int q, int steps){
+        return steps>=1 && steps<=4? kern::to_diff(q) * arith::growth[steps-1] : -1.0;
+    }
+    std::uint64_t arithmetic_key(std::string_view expr){
+        std::uint64_t h = 0xcbf29ce484222325ULL;
+        for(unsigned char c: expr){ h ^= c;  h *= 0x100000001b3ULL; }
+        return mix64(h) | (1ULL<<63);
+    }
@@ -0,0 +1,32 @@
+const path = require('path');
+
+/**
+ * In-process exponent question generator (native addon, see
+ * expo_addon.cc in the repository root). Build it with
+ * `node-gyp rebuild` at the root, or point EXPO_ADDON at the .node file.
+ */
+const addonPath =
+  process.env.EXPO_ADDON || path.join(__dirname, '../../../build/Release/expo_addon.node');
+
+let addon = null;
+const load = () => {
+  if (!addon) addon = require(addonPath);
+  return addon;
+};
+
+/**
+ * Generate distinct questions without blocking the event loop.
+ * @param {{count: number, seed?: number, minLevel?: number, maxLevel?: number}} options
+ * @returns {Promise<Array<{expression: string, answer: string, difficulty: number, level: number}>>}
+ */
+const generateQuestions = ({ count, seed = Date.now(), minLevel = 1, maxLevel = 30 }) =>
+  new Promise((resolve, reject) => {
+    load().generateAsync(count, seed, minLevel, maxLevel, (err, questions) =>
+      err ? reject(err) : resolve(questions)
+    );
+  });
+
+/** Number of distinct questions the generator can produce for a level range. */
+const questionCapacity = (minLevel = 1, maxLevel = 30) => load().capacity(minLevel, maxLevel);
+
+module.exports = { generateQuestions, questionCapacity };
@@ -0,0 +1,11 @@
+{
+  "targets": [
+    {
+      "target_name": "expo_addon",
+      "sources": ["expo_addon.cc", "expo_core.cpp"],
+      "include_dirs": ["<!(node -e \"require('nan')\")"],
+      "cflags_cc": ["-std=c++20", "-O2"],
+      "cflags_cc!": ["-fno-exceptions", "-std=gnu++17"]
+    }
+  ]
+}
@@ -0,0 +1,104 @@
+/*  corpus_convert.cpp  ─────────  JSONL question file → packed corpus
+    compile:  g++ -std=c++20 -O2 corpus_convert.cpp -o corpus_convert
+    usage:    corpus_convert IN.jsonl|- OUT.smq     convert
+              corpus_convert --info OUT.smq         per-level counts
+              corpus_convert --sample OUT.smq L N   N random level-L questions
+
+    Input lines are the flat objects expo_gen writes:
+      {"expression":"...","answer":"...","difficulty":1.25[,"level":3]}
+    "answer" may be a string or a number; without "level" the level is
+    derived from the difficulty (corpus::level_of).                     */
+    #include "corpus_format.h"
+    #include <iostream>
+    #include <fstream>
+    #include <random>
+    #include <cstdlib>
+
+    /* value of "key" in a flat JSON object; strings are returned without
+       quotes (\" and \\ unescaped), numbers as their literal text      */
+    bool json_field(std::string_view line, std::string_view key, std::string& out){
+        std::string pat = "\"" + std::string(key) + "\"";
+        std::size_t p = line.find(pat);
+        if(p==std::string_view::npos) return false;
+        p = line.find(':', p + pat.size());
+        if(p==std::string_view::npos) return false;
+        ++p;
+        while(p<line.size() && line[p]==' ') ++p;
+        out.clear();
+        if(p<line.size() && line[p]=='"'){
+            for(++p; p<line.size() && line[p]!='"'; ++p){
+                if(line[p]=='\\' && p+1<line.size()) ++p;
+                out += line[p];
+            }
+            return p<line.size();
+        }
+        while(p<line.size() && line[p]!=',' && line[p]!='}' && line[p]!=' ') out += line[p++];
+        return !out.empty();
+    }
+
+    int convert(const char* in, const char* out){
+        std::ifstream file;
+        std::istream* src = &std::cin;
+        if(std::string(in)!="-"){
+            file.open(in);
+            if(!file){ std::cerr<<"cannot open "<<in<<"\n"; return 1; }
+            src = &file;
+        }
+        corpus::Writer w(out);
+        std::string line, expr, ans, num;
+        long long lineNo = 0, written = 0;
+        while(std::getline(*src, line)){
+            ++lineNo;
+            if(line.empty()) continue;
+            if(!json_field(line,"expression",expr) || !json_field(line,"answer",ans)
+               || !json_field(line,"difficulty",num)){
+                std::cerr<<"line "<<lineNo<<": missing expression/answer/difficulty\n";
+                return 1;
+            }
+            double diff = std::strtod(num.c_str(), nullptr);
+            int level = json_field(line,"level",num)? std::atoi(num.c_str())
+                                                    : corpus::level_of(diff);
+            w.add(expr, ans, diff, level);
+            ++written;
+        }
+        w.close();
+        std::cerr<<"wrote "<<written<<" questions to "<<out<<"\n";
+        return 0;
+    }
+
+    int info(const char* path){
+        corpus::Reader r(path);
+        std::cout<<path<<": "<<r.count()<<" questions\n";
+        for(int l=1;l<=corpus::LEVELS;++l)
+            if(r.count(l)) std::cout<<"  level "<<l<<": "<<r.count(l)<<"\n";
+        return 0;
+    }
+
+    int sample(const char* path, int level, long long n){
+        corpus::Reader r(path);
+        if(level<1 || level>corpus::LEVELS || !r.count(level)){
+            std::cerr<<"no questions at level "<<level<<"\n"; return 1;
+        }
+        std::mt19937_64 rng(std::random_device{}());
+        std::uniform_int_distribution<std::uint64_t> pick(0, r.count(level)-1);
+        for(long long i=0;i<n;++i){
+            corpus::Entry e = r.at(level, pick(rng));
+            std::cout<<e.expr<<" = "<<e.ans<<"  (difficulty "<<e.difficulty<<")\n";
+        }
+        return 0;
+    }
+
+    int main(int argc, char** argv){
+        try{
+            if(argc==3 && std::string(argv[1])=="--info")   return info(argv[2]);
+            if(argc==5 && std::string(argv[1])=="--sample") return sample(argv[2], std::atoi(argv[3]), std::atoll(argv[4]));
+            if(argc==3 && (argv[1][0]!='-' || std::string(argv[1])=="-")) return convert(argv[1], argv[2]);
+        }catch(const std::exception& e){
+            std::cerr<<e.what()<<"\n";
+            return 1;
+        }
+        std::cerr<<"usage: corpus_convert IN.jsonl|- OUT.smq\n"
+                   "       corpus_convert --info OUT.smq\n"
+                   "       corpus_convert --sample OUT.smq LEVEL N\n";
+        return 1;
+    }
@@ -0,0 +1,207 @@
+/*  corpus_format.h  ─────────  packed, level-indexed question corpus
+    Header-only writer + mmap reader shared by expo_gen (--binary-out)
+    and corpus_convert.  Little-endian, all offsets in bytes.
+
+      Header        magic "SMQCORP1", version, level count, record count,
+                    level_start[31] (record index where level L begins,
+                    level_start[30] == count), records / strings offsets
+      Record[count] 16 bytes each, sorted by level, input order kept
+                    inside a level
+      strings       expression bytes immediately followed by answer bytes
+                    for every record, addressed by Record::str_off
+
+    A reader picks question i of level L with two loads and no parsing:
+    records[level_start[L-1] + i] → strings + str_off.                  */
+    #pragma once
+    #include <array>
+    #include <cmath>
+    #include <cstdint>
+    #include <cstdio>
+    #include <cstring>
+    #include <stdexcept>
+    #include <string>
+    #include <string_view>
+    #include <vector>
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+
+    namespace corpus {
+
+    constexpr int LEVELS = 30;
+    constexpr char MAGIC[8] = {'S','M','Q','C','O','R','P','1'};
+    constexpr std::uint32_t VERSION = 1;
+
+    /* difficulty → level: int(round(diff)) clamped to 1..30, the rule
+       question_generator.py uses (round half to even, like Python).    */
+    inline int level_of(double difficulty){
+        int l = (int)std::nearbyint(difficulty);
+        return l<1? 1 : l>LEVELS? LEVELS : l;
+    }
+
+    struct Header{
+        char          magic[8];
+        std::uint32_t version;
+        std::uint32_t levels;
+        std::uint64_t count;
+        std::uint64_t level_start[LEVELS+1];
+        std::uint64_t records_off;
+        std::uint64_t strings_off;
+        std::uint64_t strings_size;
+    };
+    struct Record{
+        std::uint64_t str_off;      // into the string table
+        std::uint16_t expr_len;
+        std::uint8_t  ans_len;
+        std::uint8_t  level;        // 1..30
+        std::int32_t  diff_centi;   // difficulty × 100
+    };
+    static_assert(sizeof(Record)==16, "Record must stay 16 bytes");
+
+    /*───────────────────────────────────────────────────────────────────*/
+    /*  writer: records spill to one temp file per level and strings to
+        another, so memory stays flat however large the corpus; close()
+        stitches header + levels 1..30 + strings into the final file.   */
+    class Writer{
+        std::string path_;
+        std::FILE* out_ = nullptr;
+        std::array<std::FILE*,LEVELS> lvl_{};
+        std::FILE* str_ = nullptr;
+        std::array<std::uint64_t,LEVELS> counts_{};
+        std::uint64_t str_size_ = 0;
+
+        std::string tmp(int i) const { return path_ + ".tmp" + std::to_string(i); }
+        static std::FILE* open_buffered(const std::string& p,const char* mode){
+            std::FILE* f = std::fopen(p.c_str(), mode);
+            if(!f) throw std::runtime_error("cannot open " + p);
+            std::setvbuf(f, nullptr, _IOFBF, 1<<20);
+            return f;
+        }
+        /* false if src had a write error or the copy fails */
+        static bool copy_into(std::FILE* dst, std::FILE* src){
+            if(std::fflush(src)!=0 || std::ferror(src)) return false;
+            std::vector<char> buf(1<<20);
+            std::rewind(src);
+            for(std::size_t n; (n=std::fread(buf.data(),1,buf.size(),src))>0; )
+                if(std::fwrite(buf.data(),1,n,dst)!=n) return false;
+            return !std::ferror(src);
+        }
+        /* drop everything written so far: the spills and path itself */
+        void abort(){
+            for(int l=0;l<LEVELS;++l)
+                if(lvl_[l]){ std::fclose(lvl_[l]);  lvl_[l] = nullptr;  std::remove(tmp(l).c_str()); }
+            if(str_){ std::fclose(str_);  str_ = nullptr;  std::remove(tmp(LEVELS).c_str()); }
+            if(out_){ std::fclose(out_);  out_ = nullptr;  std::remove(path_.c_str()); }
+        }
+    public:
+        explicit Writer(const std::string& path) : path_(path){
+            try{
+                out_ = open_buffered(path_, "wb");
+                for(int l=0;l<LEVELS;++l) lvl_[l] = open_buffered(tmp(l), "w+b");
+                str_ = open_buffered(tmp(LEVELS), "w+b");
+            }catch(...){ abort();  throw; }
+        }
+        Writer(const Writer&) = delete;
+        Writer& operator=(const Writer&) = delete;
+        /* only close() commits: a writer destroyed before it (an error,
+           an early return) leaves no corpus behind                      */
+        ~Writer(){ abort(); }
+
+        void add(std::string_view expr, std::string_view ans, double difficulty, int level){
+            if(expr.size()>0xFFFF || ans.size()>0xFF) throw std::length_error("question text too long");
+            if(level<1 || level>LEVELS) throw std::out_of_range("level outside 1..30");
+            Record r{ str_size_, (std::uint16_t)expr.size(), (std::uint8_t)ans.size(),
+                      (std::uint8_t)level, (std::int32_t)std::llround(difficulty*100) };
+            if(std::fwrite(expr.data(), 1, expr.size(), str_)!=expr.size()
+               || std::fwrite(ans.data(), 1, ans.size(), str_)!=ans.size()
+               || std::fwrite(&r, sizeof r, 1, lvl_[level-1])!=1)
+                throw std::runtime_error("corpus write failed: " + path_);
+            str_size_ += expr.size() + ans.size();
+            ++counts_[level-1];
+        }
+
+        void close(){
+            if(!out_) return;
+            Header h{};
+            std::memcpy(h.magic, MAGIC, sizeof MAGIC);
+            h.version = VERSION;
+            h.levels  = LEVELS;
+            for(int l=0;l<LEVELS;++l) h.level_start[l+1] = h.level_start[l] + counts_[l];
+            h.count        = h.level_start[LEVELS];
+            h.records_off  = sizeof(Header);
+            h.strings_off  = h.records_off + h.count*sizeof(Record);
+            h.strings_size = str_size_;
+            /* a spill that failed anywhere leaves no corpus behind */
+            bool ok = std::fwrite(&h, sizeof h, 1, out_)==1;
+            for(int l=0;l<LEVELS;++l){
+                ok = ok && copy_into(out_, lvl_[l]);
+                std::fclose(lvl_[l]);  lvl_[l] = nullptr;  std::remove(tmp(l).c_str());
+            }
+            ok = ok && copy_into(out_, str_);
+            std::fclose(str_);  str_ = nullptr;  std::remove(tmp(LEVELS).c_str());
+            ok = std::fflush(out_)==0 && ok;
+            ok = std::fclose(out_)==0 && ok;
+            out_ = nullptr;
+            if(!ok){
+                std::remove(path_.c_str());
+                throw std::runtime_error("corpus write failed: " + path_);
+            }
+        }
+    };
+
+    /*───────────────────────────────────────────────────────────────────*/
+    /*  reader: maps the whole file read-only                            */
+    struct Entry{
+        std::string_view expr, ans;
+        double difficulty;
+        int level;
+    };
+
+    class Reader{
+        const unsigned char* base_ = nullptr;
+        std::size_t size_ = 0;
+        const Header* h_ = nullptr;
+        const Record* rec_ = nullptr;
+        const char* str_ = nullptr;
+    public:
+        explicit Reader(const std::string& path){
+            int fd = ::open(path.c_str(), O_RDONLY);
+            if(fd<0) throw std::runtime_error("cannot open " + path);
+            struct stat st{};
+            if(::fstat(fd,&st)!=0 || (std::size_t)st.st_size<sizeof(Header)){
+                ::close(fd); throw std::runtime_error(path + ": not a corpus file");
+            }
+            size_ = st.st_size;
+            void* p = ::mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0);
+            ::close(fd);
+            if(p==MAP_FAILED) throw std::runtime_error("cannot map " + path);
+            base_ = static_cast<const unsigned char*>(p);
+            h_ = reinterpret_cast<const Header*>(base_);
+            if(std::memcmp(h_->magic, MAGIC, sizeof MAGIC)!=0 || h_->version!=VERSION
+               || h_->levels!=LEVELS
+               || h_->strings_off + h_->strings_size > size_
+               || h_->records_off + h_->count*sizeof(Record) > h_->strings_off){
+                ::munmap(p, size_); throw std::runtime_error(path + ": bad corpus header");
+            }
+            rec_ = reinterpret_cast<const Record*>(base_ + h_->records_off);
+            str_ = reinterpret_cast<const char*>(base_ + h_->strings_off);
+        }
+        Reader(const Reader&) = delete;
+        Reader& operator=(const Reader&) = delete;
+        ~Reader(){ if(base_) ::munmap(const_cast<unsigned char*>(base_), size_); }
+
+        std::uint64_t count() const { return h_->count; }
+        std::uint64_t count(int level) const {
+            return h_->level_start[level] - h_->level_start[level-1];
+        }
+        Entry at(std::uint64_t i) const {
+            const Record& r = rec_[i];
+            const char* s = str_ + r.str_off;
+            return { {s, r.expr_len}, {s + r.expr_len, r.ans_len}, r.diff_centi/100.0, r.level };
+        }
+        /* i-th question (0-based) of a level */
+        Entry at(int level, std::uint64_t i) const { return at(h_->level_start[level-1] + i); }
+    };
+
+    } // namespace corpus
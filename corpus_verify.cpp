@@ -0,0 +1,777 @@
+/*  corpus_verify.cpp  ─────────  check a JSONL question corpus
+    compile:  g++ -std=c++20 -O2 -pthread corpus_verify.cpp expo_core.cpp arith_core.cpp -o corpus_verify
+    usage:    corpus_verify [--family exponent|arithmetic] [--threads T]
+                            [--exponent-laws] [--no-dedup] [--max-report N] FILE.jsonl
+
+    FILE is mapped read-only and cut into T line-aligned chunks, one
+    thread each.  Every line is checked on its own:
+
+      syntax      a flat object with "expression", "answer", "difficulty"
+                  and optionally "level" (1..30)
+      answer      the expression is parsed (+ - * /, unary minus, ^ with
+                  an integer, a/b or parenthesised exponent, nested
+                  parentheses) and evaluated exactly: rationals, and
+                  products of prime powers with rational exponents for
+                  the roots in between (2^(5/2) * 2^(3/2) is 16).  Real
+                  principal roots: an even root of a negative number is
+                  undefined.  --exponent-laws evaluates (a^x)^y as
+                  a^(xy) and a^x * a^y / a^z as a^(x+y-z) first, the way
+                  the exponent generator scores them.
+      difficulty  exponent: the expression must render from one of the
+                  enumerated records (enumerate_all) and carry its score;
+                  arithmetic: the steps are replayed through the family's
+                  scorer (arithmetic_step_q) in evaluation order
+      duplicates  the family's dedup key (the keys expo_gen and --index
+                  use), each key held by one shard of threads afterwards
+
+    Prints counts per kind of mismatch and the first N offending lines
+    (default 10); exit status 1 if there were any.  Dedup keeps 8 bytes
+    per line plus the shard sets; --no-dedup leaves memory at the map.  */
+    #include "question_family.h"
+    #include "difficulty_kernels.h"
+    #include <algorithm>
+    #include <charconv>
+    #include <chrono>
+    #include <climits>
+    #include <cmath>
+    #include <cstdio>
+    #include <cstdlib>
+    #include <cstring>
+    #include <functional>
+    #include <iostream>
+    #include <memory>
+    #include <numeric>
+    #include <stdexcept>
+    #include <string>
+    #include <string_view>
+    #include <thread>
+    #include <vector>
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+
+    using namespace expo::detail;
+
+    namespace {
+
+    enum Kind{ SYNTAX, EXPRESSION, UNDEFINED, ANSWER, FORM, DIFFICULTY, LEVEL, DUPLICATE, KINDS };
+    const char* const kind_names[KINDS] = {
+        "malformed line", "expression syntax", "undefined value", "wrong answer",
+        "not a generator question", "wrong difficulty", "level out of range", "duplicate"
+    };
+    struct Fail{ Kind kind; const char* why; };
+
+    /*───────────────────────────────────────────────────────────────────*/
+    /*  1.  exact values                                                 */
+    /*  Rat: n/d in lowest terms, d > 0; anything that leaves 64 bits is
+        reported as overflow rather than wrapped.                        */
+    struct Rat{ long long n, d; };
+    bool operator==(const Rat& a, const Rat& b){ return a.n==b.n && a.d==b.d; }
+
+    __int128 gcd128(__int128 a, __int128 b){
+        if(a<0) a = -a;
+        while(b){ __int128 t = a%b;  a = b;  b = t; }
+        return a;
+    }
+    Rat make(__int128 n, __int128 d){
+        if(d==0) throw Fail{UNDEFINED, "division by zero"};
+        if(d<0){ n = -n;  d = -d; }
+        if(d!=1){
+            if(n>=-LLONG_MAX && n<=LLONG_MAX && d<=LLONG_MAX){     // 128-bit division is slow
+                long long g = std::gcd((long long)n, (long long)d);
+                return {(long long)n/g, (long long)d/g};
+            }
+            __int128 g = gcd128(n, d);
+            n /= g;  d /= g;
+        }
+        if(n>LLONG_MAX || n<-LLONG_MAX || d>LLONG_MAX) throw Fail{UNDEFINED, "overflow"};
+        return {(long long)n, (long long)d};
+    }
+    Rat add(Rat a, Rat b){ return make((__int128)a.n*b.d + (__int128)b.n*a.d, (__int128)a.d*b.d); }
+    Rat sub(Rat a, Rat b){ return make((__int128)a.n*b.d - (__int128)b.n*a.d, (__int128)a.d*b.d); }
+    Rat mul(Rat a, Rat b){ return make((__int128)a.n*b.n, (__int128)a.d*b.d); }
+    Rat div(Rat a, Rat b){ return make((__int128)a.n*b.d, (__int128)a.d*b.n); }
+
+    long long checked_mul(long long a, long long b){
+        long long r;
+        if(__builtin_mul_overflow(a, b, &r)) throw Fail{UNDEFINED, "overflow"};
+        return r;
+    }
+    /* b^e for an integer e; powers of a reduced fraction stay reduced */
+    Rat rpow(Rat b, long long e){
+        if(e<0){ b = div({1,1}, b);  e = -e; }
+        Rat r{1,1};
+        while(e){
+            if(e&1){ r.n = checked_mul(r.n, b.n);  r.d = checked_mul(r.d, b.d); }
+            if(e>>=1){ b.n = checked_mul(b.n, b.n);  b.d = checked_mul(b.d, b.d); }
+        }
+        return r;
+    }
+    /* r with r^k == m (m ≥ 0), or -1 */
+    long long exact_root(long long m, long long k){
+        if(m<2 || k==1) return m;
+        long long r = std::llround(std::pow((double)m, 1.0/(double)k));
+        for(long long c = std::max(2LL, r-1); c<=r+1; ++c){
+            __int128 p = 1;
+            long long i = 0;
+            for(; i<k && p<=m; ++i) p *= c;
+            if(i==k && p==m) return c;
+        }
+        return -1;
+    }
+
+    /* an irrational value: sign · Π p^e over primes, e rational.  Only
+       roots of the small bases the generators use come out this way.  */
+    struct Surd{
+        static constexpr int MAXF = 8;
+        struct F{ long long p; Rat e; };
+        int sign = 1, nf = 0;
+        F f[MAXF];
+        void push(long long p, Rat e){
+            if(nf==MAXF) throw Fail{UNDEFINED, "too many prime factors"};
+            f[nf++] = {p, e};
+        }
+    };
+    /* the prime factors of m to the power ±1, into s (unsorted) */
+    void factor_into(long long m, long long sgn, Surd& s){
+        if(m >= (1LL<<40)) throw Fail{UNDEFINED, "too large to take a root of"};
+        for(long long p=2; p*p<=m; p += 1 + (p>2)){
+            long long k = 0;
+            while(m%p==0){ m /= p;  ++k; }
+            if(k) s.push(p, {sgn*k, 1});
+        }
+        if(m>1) s.push(m, {sgn, 1});
+    }
+    Surd to_surd(Rat r){
+        Surd s;
+        s.sign = r.n<0? -1 : 1;
+        factor_into(r.n<0? -r.n : r.n, 1, s);
+        factor_into(r.d, -1, s);
+        std::sort(s.f, s.f+s.nf, [](const Surd::F& a, const Surd::F& b){ return a.p<b.p; });
+        return s;
+    }
+    /* a · b^±1, merging the factor lists */
+    Surd merge(const Surd& a, const Surd& b, bool invert){
+        Surd s;
+        s.sign = a.sign*b.sign;
+        int i = 0, j = 0;
+        while(i<a.nf || j<b.nf){
+            if(j==b.nf || (i<a.nf && a.f[i].p<b.f[j].p)){ s.push(a.f[i].p, a.f[i].e);  ++i;  continue; }
+            Rat e = invert? Rat{-b.f[j].e.n, b.f[j].e.d} : b.f[j].e;
+            long long p = b.f[j].p;
+            if(i<a.nf && a.f[i].p==p){ e = add(a.f[i].e, e);  ++i; }
+            ++j;
+            if(e.n) s.push(p, e);
+        }
+        return s;
+    }
+    bool rational(const Surd& s){
+        for(int i=0;i<s.nf;++i) if(s.f[i].e.d!=1) return false;
+        return true;
+    }
+    Rat to_rat(const Surd& s){
+        Rat r{s.sign, 1};
+        for(int i=0;i<s.nf;++i){
+            Rat p = rpow({s.f[i].p, 1}, s.f[i].e.n);
+            r.n = checked_mul(r.n, p.n);  r.d = checked_mul(r.d, p.d);
+        }
+        return r;
+    }
+
+    /* what an expression evaluates to: a rational, a surd, or (with
+       --exponent-laws) a power b^e not yet taken                        */
+    struct Value{
+        enum{ RAT, SURD, POWER } kind = RAT;
+        Rat r{0,1};     // RAT: the value; POWER: the base
+        Rat e{0,1};     // POWER: the exponent
+        Surd s;         // SURD (left uninitialised otherwise)
+    };
+    Value of(Rat r){ Value v;  v.r = r;  return v; }
+    Value of(const Surd& s){
+        if(rational(s)) return of(to_rat(s));
+        Value v;  v.kind = Value::SURD;  v.s = s;
+        return v;
+    }
+    Surd surd_of(const Value& v){ return v.kind==Value::SURD? v.s : to_surd(v.r); }
+
+    /* b^e in the reals, b rational */
+    Value raise(Rat b, Rat e){
+        if(e.d==1){
+            if(b.n==0 && e.n<0) throw Fail{UNDEFINED, "zero to a negative power"};
+            return of(rpow(b, e.n));
+        }
+        if(b.n==0){
+            if(e.n<0) throw Fail{UNDEFINED, "zero to a negative power"};
+            return of(Rat{0,1});
+        }
+        if(b.n<0 && e.d%2==0) throw Fail{UNDEFINED, "even root of a negative number"};
+        long long rn = exact_root(b.n<0? -b.n : b.n, e.d), rd = exact_root(b.d, e.d);
+        if(rn>0 && rd>0) return of(rpow({b.n<0? -rn : rn, rd}, e.n));
+        Surd s = to_surd(b);
+        s.sign = (b.n<0 && (e.n&1))? -1 : 1;
+        for(int i=0;i<s.nf;++i) s.f[i].e = mul(s.f[i].e, e);
+        return of(s);
+    }
+    void settle(Value& v){ if(v.kind==Value::POWER) v = raise(v.r, v.e); }
+
+    /*───────────────────────────────────────────────────────────────────*/
+    /*  2.  the expression grammar                                       */
+    /*      sum      := product (('+' | '-') product)*
+            product  := unary (('*' | '/') unary)*
+            unary    := '-' unary | power
+            power    := atom ('^' exponent)?
+            atom     := digits | '(' sum ')'
+            exponent := '(' sum ')' | '-'? digits ('/' digits)?
+        An exponent literal has no spaces in it, which is what tells
+        "4^-5/2" (a fractional exponent) from "4^1 / (-10)^1".  Unary
+        minus binds looser than ^: "-4^-4" is -(4^-4).
+
+        Steps: with the arithmetic family, the binary operations in the
+        order they are evaluated, scored with arithmetic_step_q as the
+        generator scored them; anything it never writes (^, a negative
+        literal, a fraction) clears `family`.                            */
+    struct Steps{ int q = 0, n = 0;  bool family = true; };
+
+    class Parser{
+        const char* p_;
+        const char* end_;
+        bool laws_;
+        Steps* steps_;
+
+        void space(){ while(p_<end_ && *p_==' ') ++p_; }
+        bool eat(char c){
+            space();
+            if(p_<end_ && *p_==c){ ++p_;  return true; }
+            return false;
+        }
+        long long digits(){
+            if(p_>=end_ || *p_<'0' || *p_>'9') throw Fail{EXPRESSION, "expected a number"};
+            long long v = 0;
+            auto [q, ec] = std::from_chars(p_, end_, v);
+            if(ec!=std::errc()) throw Fail{EXPRESSION, "number out of range"};
+            p_ = q;
+            return v;
+        }
+        void step(char op, const Value& a, const Value& b){
+            if(!steps_) return;
+            if(a.kind!=Value::RAT || b.kind!=Value::RAT || a.r.d!=1 || b.r.d!=1){ steps_->family = false;  return; }
+            if(op=='-' && !kern::sub_defined(a.r.n, b.r.n)){ steps_->family = false;  return; }
+            steps_->q += arithmetic_step_q(op, a.r.n, b.r.n);
+            ++steps_->n;
+        }
+
+        Value sum(){
+            Value v = product();
+            while(true){
+                char op;
+                if(eat('+')) op = '+';
+                else if(eat('-')) op = '-';
+                else return v;
+                Value w = product();
+                step(op, v, w);
+                settle(v);  settle(w);
+                if(v.kind!=Value::RAT || w.kind!=Value::RAT) throw Fail{UNDEFINED, "sum with an irrational term"};
+                v = of(op=='+'? add(v.r, w.r) : sub(v.r, w.r));
+            }
+        }
+        Value product(){
+            Value v = unary();
+            while(true){
+                char op;
+                if(eat('*')) op = '*';
+                else if(eat('/')) op = '/';
+                else return v;
+                Value w = unary();
+                step(op, v, w);
+                if(laws_ && v.kind==Value::POWER && w.kind==Value::POWER && v.r==w.r){
+                    v.e = op=='*'? add(v.e, w.e) : sub(v.e, w.e);       // a^x * a^y = a^(x+y)
+                    continue;
+                }
+                settle(v);  settle(w);
+                if(v.kind==Value::RAT && w.kind==Value::RAT){
+                    v = of(op=='*'? mul(v.r, w.r) : div(v.r, w.r));
+                    continue;
+                }
+                if((v.kind==Value::RAT && v.r.n==0) || (w.kind==Value::RAT && w.r.n==0)){
+                    if(op=='/' && w.kind==Value::RAT && w.r.n==0) throw Fail{UNDEFINED, "division by zero"};
+                    v = of(Rat{0,1});
+                    continue;
+                }
+                v = of(merge(surd_of(v), surd_of(w), op=='/'));
+            }
+        }
+        Value unary(){
+            space();
+            if(p_<end_ && *p_=='-'){
+                ++p_;
+                if(steps_) steps_->family = false;
+                Value v = unary();
+                settle(v);
+                if(v.kind==Value::SURD) v.s.sign = -v.s.sign; else v.r.n = -v.r.n;
+                return v;
+            }
+            return power();
+        }
+        Value power(){
+            Value v = atom();
+            if(!eat('^')) return v;
+            if(steps_) steps_->family = false;
+            Rat e = exponent();
+            if(laws_ && v.kind==Value::POWER){ v.e = mul(v.e, e);  return v; }     // (a^x)^y = a^(xy)
+            settle(v);
+            if(laws_ && v.kind==Value::RAT){ v.kind = Value::POWER;  v.e = e;  return v; }
+            if(v.kind==Value::RAT) return raise(v.r, e);
+            Surd s = v.s;
+            if(s.sign<0 && e.d%2==0) throw Fail{UNDEFINED, "even root of a negative number"};
+            s.sign = (s.sign<0 && (e.n&1))? -1 : 1;
+            for(int i=0;i<s.nf;++i) s.f[i].e = mul(s.f[i].e, e);
+            return of(s);
+        }
+        Value atom(){
+            if(eat('(')){
+                Value v = sum();
+                if(!eat(')')) throw Fail{EXPRESSION, "expected ')'"};
+                return v;
+            }
+            space();
+            return of(Rat{digits(), 1});
+        }
+        Rat exponent(){
+            if(eat('(')){
+                Value v = sum();
+                settle(v);
+                if(!eat(')')) throw Fail{EXPRESSION, "expected ')'"};
+                if(v.kind!=Value::RAT) throw Fail{UNDEFINED, "irrational exponent"};
+                return v.r;
+            }
+            space();
+            bool neg = p_<end_ && *p_=='-';
+            if(neg) ++p_;
+            long long n = digits(), d = 1;
+            if(p_+1<end_ && *p_=='/' && p_[1]>='0' && p_[1]<='9'){ ++p_;  d = digits(); }
+            return make(neg? -n : n, d);
+        }
+    public:
+        Parser(std::string_view s, bool laws, Steps* steps)
+            : p_(s.data()), end_(s.data()+s.size()), laws_(laws), steps_(steps) {}
+        Value parse(){
+            Value v = sum();
+            settle(v);
+            space();
+            if(p_!=end_) throw Fail{EXPRESSION, "unexpected text"};
+            return v;
+        }
+    };
+
+    /*───────────────────────────────────────────────────────────────────*/
+    /*  3.  one line                                                     */
+    struct Fields{
+        std::string_view expr, ans, diff, level;
+        const QRec* rec = nullptr;          // exponent: the record expr renders from
+    };
+
+    /* the exact layout expo_gen writes, without the general scan */
+    bool split_written(std::string_view s, Fields& f){
+        static constexpr std::string_view E = "{\"expression\":\"", A = "\",\"answer\":\"",
+                                          D = "\",\"difficulty\":", L = ",\"level\":";
+        if(!s.starts_with(E)) return false;
+        std::size_t i = E.size(), j = s.find('"', i);
+        if(j==std::string_view::npos || s.compare(j, A.size(), A)) return false;
+        f.expr = s.substr(i, j-i);
+        i = j + A.size();  j = s.find('"', i);
+        if(j==std::string_view::npos || s.compare(j, D.size(), D)) return false;
+        f.ans = s.substr(i, j-i);
+        i = j + D.size();  j = s.find_first_of(",}", i);
+        if(j==std::string_view::npos || j==i) return false;
+        f.diff = s.substr(i, j-i);
+        if(s[j]==','){
+            if(s.compare(j, L.size(), L)) return false;
+            i = j + L.size();  j = s.find('}', i);
+            if(j==std::string_view::npos) return false;
+            f.level = s.substr(i, j-i);
+        }
+        return j+1==s.size();
+    }
+    /* any flat object; strings are taken as they stand (the generators
+       never escape anything)                                           */
+    bool split_fields(std::string_view s, Fields& f){
+        if(split_written(s, f)) return true;
+        f = Fields{};
+        std::size_t i = 0, n = s.size();
+        auto ws = [&]{ while(i<n && (s[i]==' ' || s[i]=='\t' || s[i]=='\r')) ++i; };
+        ws();
+        if(i==n || s[i++]!='{') return false;
+        bool expr = false, ans = false, diff = false;
+        while(true){
+            ws();
+            if(i<n && s[i]=='}') break;
+            if(i==n || s[i++]!='"') return false;
+            std::size_t k = i;
+            while(i<n && s[i]!='"') ++i;
+            if(i==n) return false;
+            std::string_view key = s.substr(k, i-k);
+            ++i;  ws();
+            if(i==n || s[i++]!=':') return false;
+            ws();
+            std::string_view val;
+            if(i<n && s[i]=='"'){
+                std::size_t v = ++i;
+                while(i<n && s[i]!='"') ++i;
+                if(i==n) return false;
+                val = s.substr(v, i-v);
+                ++i;
+            }else{
+                std::size_t v = i;
+                while(i<n && s[i]!=',' && s[i]!='}' && s[i]!=' ') ++i;
+                val = s.substr(v, i-v);
+            }
+            if(key=="expression"){ f.expr = val;  expr = true; }
+            else if(key=="answer"){ f.ans = val;  ans = true; }
+            else if(key=="difficulty"){ f.diff = val;  diff = true; }
+            else if(key=="level") f.level = val;
+            ws();
+            if(i<n && s[i]==',') ++i;
+            else if(i<n && s[i]=='}') break;
+            else return false;
+        }
+        ++i;  ws();
+        return i==n && expr && ans && diff;
+    }
+    bool parse_answer(std::string_view s, Rat& r){
+        const char* p = s.data();
+        const char* end = p + s.size();
+        long long n = 0, d = 1;
+        auto a = std::from_chars(p, end, n);
+        if(a.ec!=std::errc()) return false;
+        p = a.ptr;
+        if(p<end && *p=='/'){
+            auto b = std::from_chars(p+1, end, d);
+            if(b.ec!=std::errc() || d<=0) return false;
+            p = b.ptr;
+        }
+        if(p!=end) return false;
+        r = make(n, d);
+        return true;
+    }
+    /* `text` reads as `want`, the difficulty as the writers print it
+       (to_chars, fixed, 2 places)                                      */
+    bool same_difficulty(std::string_view text, std::string_view want){
+        if(text==want) return true;
+        double got;
+        auto [p, ec] = std::from_chars(text.data(), text.data()+text.size(), got);
+        if(ec!=std::errc() || p!=text.data()+text.size()) return false;
+        char g[32];
+        return std::string_view(g, std::to_chars(g, g+sizeof g, got, std::chars_format::fixed, 2).ptr - g)==want;
+    }
+    /* q quarter points, printed so, without going through a double */
+    std::string_view quarter_text(int q, char* buf){
+        char* p = std::to_chars(buf, buf+16, q/4).ptr;
+        *p++ = '.';
+        *p++ = "0257"[q%4];
+        *p++ = "0505"[q%4];
+        return {buf, std::size_t(p-buf)};
+    }
+
+    /* the exponent family's questions by text (every enumerated record,
+       rendered), for their scores and keys                             */
+    class ExponentForms{
+        std::vector<QRec> rec_;
+        std::string text_;                      // every expression, back to back
+        std::vector<std::uint32_t> at_;         // rec_[i]'s text is text_[at_[i], at_[i+1])
+        std::vector<std::uint64_t> slot_;       // hash tag << 32 | index+1, 0 = empty
+        std::uint64_t mask_ = 0;
+
+        static std::uint64_t hash(std::string_view s){ return mix64(std::hash<std::string_view>{}(s)); }
+        std::string_view text(std::size_t i) const { return {text_.data()+at_[i], at_[i+1]-at_[i]}; }
+    public:
+        ExponentForms() : rec_(enumerate_all()){
+            QText t;
+            at_.push_back(0);
+            for(const QRec& r: rec_){
+                render(r, t);
+                text_ += t.expr();
+                at_.push_back((std::uint32_t)text_.size());
+            }
+            std::uint64_t cap = 16;
+            while(cap < rec_.size()*2) cap <<= 1;
+            slot_.assign(cap, 0);
+            mask_ = cap - 1;
+            for(std::size_t i=0;i<rec_.size();++i){
+                std::uint64_t h = hash(text(i));
+                std::uint64_t j = h & mask_;
+                while(slot_[j]) j = (j+1) & mask_;
+                slot_[j] = (h>>32<<32) | (i+1);
+            }
+        }
+        const QRec* find(std::string_view expr) const {
+            std::uint64_t h = hash(expr);
+            for(std::uint64_t j = h & mask_; slot_[j]; j = (j+1) & mask_){
+                std::size_t i = (slot_[j] & 0xffffffffu) - 1;
+                if((slot_[j]>>32)==(h>>32) && text(i)==expr) return &rec_[i];
+            }
+            return nullptr;
+        }
+    };
+
+    struct Options{
+        bool arithmetic = false, laws = false, dedup = true;
+        const ExponentForms* forms = nullptr;
+    };
+
+    /* the line's dedup key, 0 if it has none (not a family question) */
+    std::uint64_t key_of(const Options& o, const Fields& f){
+        if(o.arithmetic) return arithmetic_key(f.expr);
+        return f.rec? question_key(*f.rec) : 0;
+    }
+
+    /* every check on one line but dedup; throws Fail */
+    void check_line(const Options& o, std::string_view line, Fields& f){
+        if(!split_fields(line, f)) throw Fail{SYNTAX, "not a flat object with expression, answer and difficulty"};
+        if(!o.arithmetic) f.rec = o.forms->find(f.expr);
+        Rat ans;
+        if(!parse_answer(f.ans, ans)) throw Fail{SYNTAX, "answer is not an integer or n/d"};
+        if(!f.level.empty()){
+            int level = 0;
+            auto [p, ec] = std::from_chars(f.level.data(), f.level.data()+f.level.size(), level);
+            if(ec!=std::errc() || p!=f.level.data()+f.level.size() || level<1 || level>corpus::LEVELS)
+                throw Fail{LEVEL, "level is not 1..30"};
+        }
+        Steps steps;
+        Value v = Parser(f.expr, o.laws, o.arithmetic? &steps : nullptr).parse();
+        if(v.kind!=Value::RAT) throw Fail{ANSWER, "the expression is irrational"};
+        if(!(v.r==ans)) throw Fail{ANSWER, "answer is not the value of the expression"};
+        char buf[32];
+        std::string_view want;
+        if(o.arithmetic){
+            if(!steps.family || steps.n<1 || steps.n>4) throw Fail{FORM, "not a chain of 1..4 + - * / steps"};
+            double d = arithmetic_difficulty(steps.q, steps.n);
+            want = {buf, std::size_t(std::to_chars(buf, buf+sizeof buf, d, std::chars_format::fixed, 2).ptr - buf)};
+        }else{
+            if(!f.rec) throw Fail{FORM, "no exponent record renders to this expression"};
+            want = quarter_text(f.rec->q, buf);
+        }
+        if(!same_difficulty(f.diff, want)) throw Fail{DIFFICULTY, "difficulty is not the scorer's"};
+    }
+
+    /*───────────────────────────────────────────────────────────────────*/
+    /*  4.  chunks, shards and the report                                */
+    struct Issue{ std::uint64_t line;  Kind kind;  std::string why, text; };
+
+    struct Chunk{
+        const char* begin;
+        const char* end;
+        std::uint64_t lines = 0, first = 0;                 // first: global line number - 1
+        std::uint64_t count[KINDS]{};
+        std::vector<Issue> issues;                          // first --max-report, local line numbers
+        std::vector<std::vector<std::uint64_t>> keys;       // [shard]
+    };
+
+    std::size_t shard_of(std::uint64_t k, std::size_t shards){ return (mix64(k)>>32) % shards; }
+
+    template<class F>
+    void each_line(const Chunk& c, F&& f){
+        const char* p = c.begin;
+        std::uint64_t n = 0;
+        while(p<c.end){
+            const char* nl = static_cast<const char*>(std::memchr(p, '\n', c.end-p));
+            const char* e = nl? nl : c.end;
+            f(n++, std::string_view(p, e-p));
+            p = e + 1;
+        }
+    }
+
+    void verify_chunk(const Options& o, std::size_t maxReport, std::size_t shards, Chunk& c){
+        c.keys.assign(o.dedup? shards : 0, {});
+        Fields f;
+        auto note = [&](std::uint64_t n, Kind k, const char* why, std::string_view line){
+            ++c.count[k];
+            if(c.issues.size()<maxReport) c.issues.push_back({n, k, why, std::string(line.substr(0, 160))});
+        };
+        each_line(c, [&](std::uint64_t n, std::string_view line){
+            c.lines = n + 1;
+            if(line.find_first_not_of(" \t\r")==std::string_view::npos) return;
+            f = Fields{};
+            try{
+                check_line(o, line, f);
+            }catch(const Fail& e){
+                note(n, e.kind, e.why, line);
+            }catch(const std::exception&){
+                note(n, DIFFICULTY, "the scorer rejects an operand", line);
+            }
+            if(o.dedup && !f.expr.empty())
+                if(std::uint64_t k = key_of(o, f)) c.keys[shard_of(k, shards)].push_back(k);
+        });
+    }
+
+    /* shard s's keys from every chunk, in line order; the first
+       maxReport repeated keys are returned for locating              */
+    std::uint64_t dedup_shard(std::vector<Chunk>& chunks, std::size_t s, std::size_t maxReport,
+                              std::vector<std::uint64_t>& repeated){
+        std::size_t total = 0;
+        for(const Chunk& c: chunks) total += c.keys[s].size();
+        FlatKeySet seen(total);
+        std::uint64_t dups = 0;
+        for(Chunk& c: chunks){
+            for(std::uint64_t k: c.keys[s])
+                if(!seen.insert(k)){
+                    ++dups;
+                    if(repeated.size()<maxReport) repeated.push_back(k);
+                }
+            std::vector<std::uint64_t>().swap(c.keys[s]);
+        }
+        return dups;
+    }
+
+    struct Mapped{
+        const char* data = nullptr;
+        std::size_t size = 0;
+        explicit Mapped(const char* path){
+            int fd = ::open(path, O_RDONLY);
+            if(fd<0) throw std::runtime_error(std::string("cannot open ") + path);
+            struct stat st{};
+            if(::fstat(fd, &st)!=0){ ::close(fd);  throw std::runtime_error(std::string("cannot stat ") + path); }
+            size = st.st_size;
+            if(size){
+                void* p = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+                if(p==MAP_FAILED){ ::close(fd);  throw std::runtime_error(std::string("cannot map ") + path); }
+                ::madvise(p, size, MADV_SEQUENTIAL);
+                data = static_cast<const char*>(p);
+            }
+            ::close(fd);
+        }
+        Mapped(const Mapped&) = delete;
+        Mapped& operator=(const Mapped&) = delete;
+        ~Mapped(){ if(data) ::munmap(const_cast<char*>(data), size); }
+    };
+
+    template<class F>
+    void parallel(std::size_t n, F&& f){
+        std::vector<std::thread> pool;
+        for(std::size_t i=1;i<n;++i) pool.emplace_back(f, i);
+        f(0);
+        for(std::thread& t: pool) t.join();
+    }
+
+    int usage(){
+        std::cerr<<"usage: corpus_verify [--family exponent|arithmetic] [--threads T]\n"
+                   "                     [--exponent-laws] [--no-dedup] [--max-report N] FILE.jsonl\n";
+        return 1;
+    }
+
+    } // namespace
+
+    int main(int argc, char** argv){
+        Options o;
+        std::size_t threads = std::max(1u, std::thread::hardware_concurrency()), maxReport = 10;
+        const char* path = nullptr;
+        for(int i=1;i<argc;++i){
+            std::string a = argv[i];
+            if(a=="--family" && i+1<argc){
+                std::string_view fam = argv[++i];
+                if(fam!="exponent" && fam!="arithmetic"){ std::cerr<<"unknown family "<<fam<<"\n";  return 1; }
+                o.arithmetic = fam=="arithmetic";
+            }
+            else if(a=="--threads" && i+1<argc) threads = std::max(1L, std::atol(argv[++i]));
+            else if(a=="--max-report" && i+1<argc) maxReport = std::max(0L, std::atol(argv[++i]));
+            else if(a=="--exponent-laws") o.laws = true;
+            else if(a=="--no-dedup") o.dedup = false;
+            else if(a[0]!='-' && !path) path = argv[i];
+            else return usage();
+        }
+        if(!path) return usage();
+
+        std::unique_ptr<ExponentForms> forms;
+        if(!o.arithmetic) o.forms = (forms = std::make_unique<ExponentForms>()).get();
+        std::unique_ptr<Mapped> map;
+        try{ map = std::make_unique<Mapped>(path); }
+        catch(const std::exception& e){ std::cerr<<e.what()<<"\n";  return 1; }
+        auto t0 = std::chrono::steady_clock::now();
+
+        /* line-aligned chunks: each starts after a '\n' */
+        const char* data = map->data;
+        const char* end = data + map->size;
+        std::vector<Chunk> chunks(threads);
+        const char* at = data;
+        for(std::size_t t=0;t<threads;++t){
+            const char* stop = t+1==threads? end : data + map->size/threads*(t+1);
+            if(stop<at) stop = at;
+            if(stop<end){
+                const char* nl = static_cast<const char*>(std::memchr(stop, '\n', end-stop));
+                stop = nl? nl+1 : end;
+            }
+            chunks[t].begin = at;  chunks[t].end = stop;
+            at = stop;
+        }
+        parallel(threads, [&](std::size_t t){ verify_chunk(o, maxReport, threads, chunks[t]); });
+        auto t1 = std::chrono::steady_clock::now();
+
+        std::uint64_t lines = 0, count[KINDS]{};
+        std::vector<Issue> issues;
+        for(Chunk& c: chunks){
+            c.first = lines;
+            lines += c.lines;
+            for(int k=0;k<KINDS;++k) count[k] += c.count[k];
+            for(Issue& is: c.issues){ is.line += c.first + 1;  issues.push_back(std::move(is)); }
+        }
+
+        /* duplicates: one shard per thread, then the first few located */
+        if(o.dedup){
+            std::vector<std::uint64_t> dups(threads);
+            std::vector<std::vector<std::uint64_t>> repeated(threads);
+            parallel(threads, [&](std::size_t s){ dups[s] = dedup_shard(chunks, s, maxReport, repeated[s]); });
+            std::vector<std::uint64_t> wanted;
+            for(std::size_t s=0;s<threads;++s){
+                count[DUPLICATE] += dups[s];
+                wanted.insert(wanted.end(), repeated[s].begin(), repeated[s].end());
+            }
+            std::sort(wanted.begin(), wanted.end());
+            wanted.erase(std::unique(wanted.begin(), wanted.end()), wanted.end());
+            if(!wanted.empty()){
+                struct Hit{ std::uint64_t key, line;  std::string_view text; };
+                std::vector<std::vector<Hit>> hits(threads);
+                parallel(threads, [&](std::size_t t){
+                    Fields f;
+                    each_line(chunks[t], [&](std::uint64_t n, std::string_view line){
+                        f = Fields{};
+                        if(!split_fields(line, f)) return;
+                        if(!o.arithmetic) f.rec = o.forms->find(f.expr);
+                        std::uint64_t k = key_of(o, f);
+                        if(k && std::binary_search(wanted.begin(), wanted.end(), k))
+                            hits[t].push_back({k, chunks[t].first + n + 1, line});
+                    });
+                });
+                std::vector<Hit> all;
+                for(auto& h: hits) all.insert(all.end(), h.begin(), h.end());
+                std::stable_sort(all.begin(), all.end(),          // lines stay ascending per key
+                                 [](const Hit& a, const Hit& b){ return a.key<b.key; });
+                for(std::size_t i=0, first=0;i<all.size();++i){
+                    if(!i || all[i].key!=all[i-1].key){ first = all[i].line;  continue; }
+                    issues.push_back({all[i].line, DUPLICATE, "of line " + std::to_string(first),
+                                      std::string(all[i].text.substr(0, 160))});
+                }
+            }
+        }
+        auto t2 = std::chrono::steady_clock::now();
+
+        std::uint64_t bad = 0;
+        for(int k=0;k<KINDS;++k) bad += count[k];
+        std::sort(issues.begin(), issues.end(), [](const Issue& a, const Issue& b){ return a.line<b.line; });
+        if(issues.size()>maxReport) issues.resize(maxReport);
+        for(const Issue& is: issues){
+            std::cout<<"line "<<is.line<<": "<<kind_names[is.kind];
+            std::cout<<" ("<<is.why<<")";
+            std::cout<<": "<<is.text<<"\n";
+        }
+
+        double secs = std::chrono::duration<double>(t2-t0).count();
+        double check = std::chrono::duration<double>(t1-t0).count();
+        std::cout<<lines<<" lines, "<<bad<<" mismatches\n";
+        for(int k=0;k<KINDS;++k)
+            if(count[k]) std::cout<<"  "<<kind_names[k]<<": "<<count[k]<<"\n";
+        char rate[160];
+        std::snprintf(rate, sizeof rate, "%.2f s (checks %.2f s, %.0f MB/s, %.1f M lines/s; %zu threads)\n",
+                      secs, check, map->size/1e6/check, lines/1e6/check, threads);
+        std::cout<<rate;
+        return bad? 1 : 0;
+    }
@@ -0,0 +1,192 @@
+/*  dedup_index.h  ─────────  persistent dedup index (expo_gen --index)
+    The keys of every question already in a corpus, in a file mapped
+    read-write: FlatKeySet's open-addressing layout (linear probing from
+    mix64(key), 0 = empty, at most 3/4 full) behind a small header.
+
+      Header        magic "SMQINDX1", version, family name, slot count
+                    (a power of two), key count
+      slots[n]      64-bit question keys (QuestionFamily::key)
+
+    A run opens the index, skips questions whose key is in it and
+    stages the keys of the questions it writes in a spill file,
+    FILE.new (stage; 8 bytes a question on disk, none in memory).  Once
+    its output is safely closed, commit() renames the spill to
+    FILE.commit, inserts its keys and removes it, so growing a corpus
+    costs the new questions only.  A run that fails or dies before
+    commit() leaves FILE as it was (the next open drops the stale
+    spill); one that dies during it leaves FILE.commit, which the next
+    open replays (inserting is idempotent).  Growing the table writes a
+    new file and renames it over the old one; nothing else moves.  Not
+    safe for concurrent use: probe and stage while writing, commit
+    after.                                                              */
+    #pragma once
+    #include <algorithm>
+    #include <cstdint>
+    #include <cstdio>
+    #include <cstring>
+    #include <stdexcept>
+    #include <string>
+    #include <string_view>
+    #include <utility>
+    #include <vector>
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+    #include "expo_core.h"
+
+    class KeyIndex{
+    public:
+        static constexpr char MAGIC[8] = {'S','M','Q','I','N','D','X','1'};
+        static constexpr std::uint32_t VERSION = 1;
+        struct Header{
+            char          magic[8];
+            std::uint32_t version;
+            char          family[20];       // NUL-padded
+            std::uint64_t slots;
+            std::uint64_t count;
+        };
+        static_assert(sizeof(Header)==48, "Header must stay 48 bytes");
+
+    private:
+        std::string path_;
+        void* base_ = nullptr;
+        std::size_t size_ = 0;
+        Header* h_ = nullptr;
+        std::uint64_t* slot_ = nullptr;
+        std::uint64_t mask_ = 0;
+        std::FILE* spill_ = nullptr;            // path.new while keys are staged
+
+        static std::uint64_t slots_for(std::uint64_t keys){
+            std::uint64_t cap = 16;
+            while(cap*3 < keys*4) cap <<= 1;
+            return cap;
+        }
+        /* map `path`, creating it with `slots` empty slots if asked */
+        void map(const std::string& path, std::uint64_t slots, std::string_view family, bool create){
+            int fd = ::open(path.c_str(), create? O_RDWR|O_CREAT|O_TRUNC : O_RDWR, 0644);
+            if(fd<0) throw std::runtime_error("cannot open " + path);
+            struct stat st{};
+            if(create){
+                size_ = sizeof(Header) + slots*sizeof(std::uint64_t);
+                if(::ftruncate(fd, size_)!=0){ ::close(fd); throw std::runtime_error("cannot size " + path); }
+            }else{
+                if(::fstat(fd,&st)!=0 || (std::size_t)st.st_size<sizeof(Header)){
+                    ::close(fd); throw std::runtime_error(path + ": not an index file");
+                }
+                size_ = st.st_size;
+            }
+            void* p = ::mmap(nullptr, size_, PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
+            ::close(fd);
+            if(p==MAP_FAILED) throw std::runtime_error("cannot map " + path);
+            base_ = p;
+            h_ = static_cast<Header*>(p);
+            slot_ = reinterpret_cast<std::uint64_t*>(h_+1);
+            if(create){                                     // ftruncate zeroed the slots
+                std::memcpy(h_->magic, MAGIC, sizeof MAGIC);
+                h_->version = VERSION;
+                std::memset(h_->family, 0, sizeof h_->family);
+                std::memcpy(h_->family, family.data(), std::min(family.size(), sizeof h_->family - 1));
+                h_->slots = slots;
+                h_->count = 0;
+            }else if(std::memcmp(h_->magic, MAGIC, sizeof MAGIC)!=0 || h_->version!=VERSION
+                     || (h_->slots & (h_->slots-1)) || h_->slots<16
+                     || sizeof(Header) + h_->slots*sizeof(std::uint64_t) != size_){
+                unmap();  throw std::runtime_error(path + ": bad index header");
+            }else if(family != std::string_view(h_->family, strnlen(h_->family, sizeof h_->family))){
+                std::string has(h_->family, strnlen(h_->family, sizeof h_->family));
+                unmap();  throw std::runtime_error(path + " indexes the " + has + " family");
+            }
+            mask_ = h_->slots - 1;
+        }
+        void unmap(){
+            if(base_) ::munmap(base_, size_);
+            base_ = nullptr;  h_ = nullptr;  slot_ = nullptr;
+        }
+        bool place(std::uint64_t k){
+            for(std::uint64_t i = expo::detail::mix64(k) & mask_; ; i = (i+1) & mask_){
+                if(slot_[i]==k) return false;
+                if(!slot_[i]){ slot_[i] = k;  ++h_->count;  return true; }
+            }
+        }
+        /* insert every key of the journal at `journal`, flush, remove it */
+        void replay(const std::string& journal){
+            std::FILE* f = std::fopen(journal.c_str(), "rb");
+            if(!f) throw std::runtime_error("cannot open " + journal);
+            struct stat st{};
+            if(::fstat(::fileno(f), &st)==0) reserve(st.st_size/sizeof(std::uint64_t));
+            std::vector<std::uint64_t> buf(1<<16);
+            for(std::size_t n; (n=std::fread(buf.data(), sizeof buf[0], buf.size(), f))>0; )
+                for(std::size_t i=0;i<n;++i) place(buf[i]);
+            bool ok = !std::ferror(f);
+            std::fclose(f);
+            if(!ok) throw std::runtime_error("cannot read " + journal);
+            sync();
+            std::remove(journal.c_str());
+        }
+    public:
+        /* open `path`, or create it if missing; room for `more` keys.
+           Finishes a commit an earlier run died in and drops its spill. */
+        KeyIndex(const std::string& path, std::string_view family, std::uint64_t more = 0) : path_(path){
+            struct stat st{};
+            map(path_, slots_for(more), family, ::stat(path_.c_str(), &st)!=0);
+            if(::stat((path_ + ".commit").c_str(), &st)==0) replay(path_ + ".commit");
+            std::remove((path_ + ".new").c_str());
+            reserve(more);
+        }
+        KeyIndex(const KeyIndex&) = delete;
+        KeyIndex& operator=(const KeyIndex&) = delete;
+        /* staged keys that were never committed are dropped */
+        ~KeyIndex(){
+            if(spill_){ std::fclose(spill_);  std::remove((path_ + ".new").c_str()); }
+            sync();  unmap();
+        }
+
+        std::uint64_t size()  const { return h_->count; }
+        std::uint64_t bytes() const { return size_; }
+
+        bool contains(std::uint64_t k) const {
+            for(std::uint64_t i = expo::detail::mix64(k) & mask_; ; i = (i+1) & mask_){
+                if(slot_[i]==k) return true;
+                if(!slot_[i]) return false;
+            }
+        }
+        /* k goes in at the next commit(); not seen by contains() before */
+        void stage(std::uint64_t k){
+            if(!spill_){
+                std::string p = path_ + ".new";
+                if(!(spill_ = std::fopen(p.c_str(), "wb"))) throw std::runtime_error("cannot open " + p);
+                std::setvbuf(spill_, nullptr, _IOFBF, 1<<20);
+            }
+            if(std::fwrite(&k, sizeof k, 1, spill_)!=1) throw std::runtime_error("index spill write failed: " + path_);
+        }
+        /* insert everything staged, durably (see the top of the file) */
+        void commit(){
+            if(!spill_) return;
+            bool ok = std::fflush(spill_)==0 && ::fsync(::fileno(spill_))==0;
+            ok = std::fclose(spill_)==0 && ok;
+            spill_ = nullptr;
+            std::string staged = path_ + ".new", journal = path_ + ".commit";
+            if(!ok || std::rename(staged.c_str(), journal.c_str())!=0){
+                std::remove(staged.c_str());
+                throw std::runtime_error("index spill write failed: " + path_);
+            }
+            replay(journal);
+        }
+        /* grow (rehash into path.tmp, rename over path) until `more`
+           further keys fit under the 3/4 load                          */
+        void reserve(std::uint64_t more){
+            std::uint64_t want = slots_for(h_->count + more);
+            if(want<=h_->slots) return;
+            std::string family(h_->family, strnlen(h_->family, sizeof h_->family));
+            void* oldBase = base_;  std::size_t oldSize = size_;
+            const std::uint64_t* old = slot_;  std::uint64_t oldSlots = h_->slots;
+            std::string tmp = path_ + ".tmp";
+            map(tmp, want, family, true);
+            for(std::uint64_t i=0;i<oldSlots;++i) if(old[i]) place(old[i]);
+            ::munmap(oldBase, oldSize);
+            sync();
+            if(std::rename(tmp.c_str(), path_.c_str())!=0) throw std::runtime_error("cannot replace " + path_);
+        }
+        void sync(){ if(base_) ::msync(base_, size_, MS_SYNC); }
+    };
@@ -0,0 +1,151 @@
+/*  difficulty_kernels.h  ─────────  allocation-free +-×÷ difficulty kernels
+    The digit-walk scorers every question family is scored with.  Each
+    original score (expo_core.cpp section 0, question_generator.py) is a
+    sum of 0.5 and 0.75 steps, so the kernels count quarter points in an
+    int and q*0.25 is bit-identical to the double sums.  Operands are
+    walked digit by digit exactly as std::to_string prints them,
+    including the quirk that a leading '-' acts as the digit
+    '-'-'0' == -3.  Products wrap like the originals do instead of being
+    undefined.  --check-kernels holds these to the string versions.    */
+    #pragma once
+    #include <cstddef>
+    #include <stdexcept>
+    #include <utility>
+
+    namespace kern {
+        struct Digits{ signed char d[20]; int n; };   // most significant first
+
+        constexpr Digits digits(long long x){
+            Digits r{};
+            unsigned long long u = x<0 ? 0ULL-(unsigned long long)x
+                                       : (unsigned long long)x;
+            signed char tmp[20]; int k=0;
+            do{ tmp[k++] = (signed char)(u%10); u/=10; }while(u);
+            if(x<0) r.d[r.n++] = '-'-'0';
+            while(k) r.d[r.n++] = tmp[--k];
+            return r;
+        }
+        constexpr int num_chars(long long x){
+            unsigned long long u = x<0 ? 0ULL-(unsigned long long)x
+                                       : (unsigned long long)x;
+            int n = (x<0) + 1;
+            while(u>=10){ u/=10; ++n; }
+            return n;
+        }
+        constexpr long long wrap_add(long long a,long long b){
+            return (long long)((unsigned long long)a+(unsigned long long)b);
+        }
+        constexpr long long wrap_mul(long long a,long long b){
+            return (long long)((unsigned long long)a*(unsigned long long)b);
+        }
+        /* static_cast<long long>(std::pow(10,k)); past 10^18 x86 yields INT64_MIN */
+        constexpr long long pow10_ll(int k){
+            long long p=1;
+            if(k>18) return (long long)(1ULL<<63);
+            while(k--) p*=10;
+            return p;
+        }
+
+        constexpr int add_q(long long a,long long b){
+            Digits x=digits(a), y=digits(b);
+            int n = x.n>y.n? x.n : y.n;
+            int carry=0, cnt=0;
+            for(int i=1;i<=n;++i){
+                int dx = i<=x.n? x.d[x.n-i] : 0;
+                int dy = i<=y.n? y.d[y.n-i] : 0;
+                if(dx+dy+carry>=10){ cnt++; carry=1; } else carry=0;
+            }
+            return 2*(x.n<y.n? x.n : y.n) + 3*cnt;
+        }
+        /* the original pads with big.size()-small.size(); when the smaller
+           operand prints longer that count wraps and insert() throws      */
+        constexpr bool sub_defined(long long a,long long b){
+            if(a>b) std::swap(a,b);
+            return num_chars(a)<=num_chars(b);
+        }
+        constexpr int sub_q(long long a,long long b){
+            if(a>b) std::swap(a,b);
+            Digits small=digits(a), big=digits(b);
+            if(small.n>big.n) throw std::length_error("basic_string::_M_replace_aux");
+            int borrow=0, cnt=0;
+            for(int i=1;i<=big.n;++i){
+                int top = big.d[big.n-i]-borrow;
+                int s   = i<=small.n? small.d[small.n-i] : 0;
+                if(top<s){ cnt++; borrow=1; } else borrow=0;
+            }
+            return 2*small.n + 3*cnt;
+        }
+        struct MulQ{ long long total; int q; };
+        constexpr MulQ mul1_q(int d,long long num){
+            Digits s=digits(num);
+            int q=0; long long total=0;
+            for(int i=s.n-1;i>=0;--i){
+                q += 2;
+                long long part = wrap_mul(1LL*d*s.d[i], pow10_ll(s.n-1-i));
+                if(total){ q+=add_q(total,part); total=wrap_add(total,part); } else total=part;
+            }
+            return {total,q};
+        }
+        constexpr MulQ mul_q(long long A,long long B){
+            Digits a=digits(A);
+            int q=0; long long total=0;
+            for(int i=0;i<a.n;++i){
+                if(a.d[i]==0) continue;
+                MulQ m = mul1_q(a.d[i],B);
+                q += m.q;
+                long long val = wrap_mul(m.total, pow10_ll(a.n-1-i));
+                if(total){ q+=add_q(total,val); total=wrap_add(total,val); } else total=val;
+            }
+            return {total,q};
+        }
+        constexpr int div_q(long long dividend,long long divisor){
+            Digits s=digits(dividend);
+            int q=0; long long rem=0;
+            for(int i=0;i<s.n;++i){
+                rem = wrap_add(wrap_mul(rem,10), s.d[i]);
+                if(rem<divisor) continue;
+                q += sub_q(rem,divisor);
+                rem -= divisor;
+            }
+            return q;
+        }
+        constexpr double to_diff(int q){ return q*0.25; }
+
+        /* batch forms: non-negative lanes use the digit-sum identity
+             carries(a+b) = (S(a)+S(b)-S(a+b))/9,  borrows(b-a) = carries(a+(b-a))
+           which is straight-line per lane and auto-vectorises; lanes with a
+           negative operand fall back to the scalar kernel afterwards.     */
+        inline int dsum(unsigned long long u){
+            int s=0;
+            for(int k=0;k<20;++k){ s += (int)(u%10); u/=10; }
+            return s;
+        }
+        inline int ndigits(unsigned long long u){
+            int n=1;
+            for(int k=1;k<20;++k) n += (u>=(unsigned long long)pow10_ll(k));
+            return n;
+        }
+        inline void add_batch(const long long* a,const long long* b,double* out,std::size_t n){
+            for(std::size_t i=0;i<n;++i){
+                unsigned long long x=(unsigned long long)a[i], y=(unsigned long long)b[i];
+                int nx=ndigits(x), ny=ndigits(y);
+                int carries=(dsum(x)+dsum(y)-dsum(x+y))/9;
+                out[i] = to_diff(2*(nx<ny? nx : ny) + 3*carries);
+            }
+            for(std::size_t i=0;i<n;++i)
+                if(a[i]<0 || b[i]<0) out[i] = to_diff(add_q(a[i],b[i]));
+        }
+        inline void sub_batch(const long long* a,const long long* b,double* out,std::size_t n){
+            for(std::size_t i=0;i<n;++i){
+                unsigned long long x=(unsigned long long)a[i], y=(unsigned long long)b[i];
+                unsigned long long lo = x<y? x : y, hi = x<y? y : x;
+                int borrows=(dsum(lo)+dsum(hi-lo)-dsum(hi))/9;
+                out[i] = to_diff(2*ndigits(lo) + 3*borrows);
+            }
+            for(std::size_t i=0;i<n;++i)
+                if(a[i]<0 || b[i]<0) out[i] = to_diff(sub_q(a[i],b[i]));
+        }
+        inline void mul_batch(const long long* a,const long long* b,double* out,std::size_t n){
+            for(std::size_t i=0;i<n;++i) out[i] = to_diff(mul_q(a[i],b[i]).q);
+        }
+    } // namespace kern
@@ -0,0 +1,151 @@
+/*  expo_addon.cc  ─────────  Node binding for expo_core (nan)
+    build:  node-gyp rebuild            (binding.gyp)
+       or:  g++ -std=c++20 -O2 -shared -fPIC -I/usr/include/node
+                -Inode_modules/nan expo_addon.cc expo_core.cpp
+                -o build/Release/expo_addon.node
+
+    const expo = require('./build/Release/expo_addon.node');
+    expo.generate(count, seed[, minLevel, maxLevel])
+        → [{expression, answer, difficulty, level}, ...]
+    expo.generateAsync(count, seed[, minLevel, maxLevel], (err, list) => ...)
+        same, generated off the event loop
+    expo.generateInRange(count, seed, minDifficulty, maxDifficulty)
+        → the same records, drawn directly from a difficulty band
+          (either bound may be ±Infinity)
+    expo.capacity([minLevel, maxLevel]) → distinct questions in the range
+
+    seed is a Number (integers up to 2^53 are exact) or a BigInt.       */
+    #include <nan.h>
+    #include "expo_core.h"
+
+    namespace {
+
+    struct Args{
+        std::size_t count = 0;
+        std::uint64_t seed = 0;
+        int min_level = 1, max_level = corpus::LEVELS;
+        double min_diff = 0, max_diff = 0;
+    };
+
+    /* false (with a JS exception pending) on bad arguments; only
+       info[0..argc) are looked at (the async form ends in a callback)   */
+    bool read_levels(Nan::NAN_METHOD_ARGS_TYPE info, int argc, int at, Args& a){
+        if(argc>at && !info[at]->IsUndefined()){
+            if(!info[at]->IsNumber()){ Nan::ThrowTypeError("minLevel must be a number"); return false; }
+            a.min_level = Nan::To<int>(info[at]).FromJust();
+        }
+        if(argc>at+1 && !info[at+1]->IsUndefined()){
+            if(!info[at+1]->IsNumber()){ Nan::ThrowTypeError("maxLevel must be a number"); return false; }
+            a.max_level = Nan::To<int>(info[at+1]).FromJust();
+        }
+        return true;
+    }
+
+    /* count and seed, info[0] and info[1] */
+    bool read_count_seed(Nan::NAN_METHOD_ARGS_TYPE info, int argc, Args& a, const char* usage){
+        if(argc<2 || !info[0]->IsNumber()){ Nan::ThrowTypeError(usage); return false; }
+        double count = Nan::To<double>(info[0]).FromJust();
+        if(!(count>=0) || count>4294967295.0){ Nan::ThrowRangeError("count out of range"); return false; }
+        a.count = (std::size_t)count;
+        if(info[1]->IsBigInt()){
+            a.seed = info[1].As<v8::BigInt>()->Uint64Value();
+        }else if(info[1]->IsNumber()){
+            double s = Nan::To<double>(info[1]).FromJust();
+            if(!(s>=0) || s>=18446744073709551616.0){ Nan::ThrowRangeError("seed out of range"); return false; }
+            a.seed = (std::uint64_t)s;
+        }else{
+            Nan::ThrowTypeError("seed must be a number or BigInt"); return false;
+        }
+        return true;
+    }
+
+    bool read_args(Nan::NAN_METHOD_ARGS_TYPE info, int argc, Args& a){
+        return read_count_seed(info, argc, a, "usage: generate(count, seed[, minLevel, maxLevel])")
+            && read_levels(info, argc, 2, a);
+    }
+
+    v8::Local<v8::Array> to_js(const std::vector<expo::Record>& recs){
+        v8::Local<v8::Array> out = Nan::New<v8::Array>((int)recs.size());
+        v8::Local<v8::String> kExpr = Nan::New("expression").ToLocalChecked(),
+                              kAns  = Nan::New("answer").ToLocalChecked(),
+                              kDiff = Nan::New("difficulty").ToLocalChecked(),
+                              kLvl  = Nan::New("level").ToLocalChecked();
+        for(std::size_t i=0;i<recs.size();++i){
+            const expo::Record& r = recs[i];
+            v8::Local<v8::Object> o = Nan::New<v8::Object>();
+            Nan::Set(o, kExpr, Nan::New(r.expression).ToLocalChecked());
+            Nan::Set(o, kAns,  Nan::New(r.answer).ToLocalChecked());
+            Nan::Set(o, kDiff, Nan::New(r.difficulty));
+            Nan::Set(o, kLvl,  Nan::New(r.level));
+            Nan::Set(out, (std::uint32_t)i, o);
+        }
+        return out;
+    }
+
+    NAN_METHOD(Generate){
+        Args a;
+        if(!read_args(info, info.Length(), a)) return;
+        try{
+            info.GetReturnValue().Set(to_js(expo::generate(a.count, a.seed, a.min_level, a.max_level)));
+        }catch(const std::exception& e){ Nan::ThrowRangeError(e.what()); }
+    }
+
+    class GenerateWorker : public Nan::AsyncWorker{
+        Args a_;
+        std::vector<expo::Record> recs_;
+    public:
+        GenerateWorker(Nan::Callback* cb, const Args& a) : Nan::AsyncWorker(cb, "expo:generate"), a_(a) {}
+        void Execute() override {
+            try{ recs_ = expo::generate(a_.count, a_.seed, a_.min_level, a_.max_level); }
+            catch(const std::exception& e){ SetErrorMessage(e.what()); }
+        }
+        void HandleOKCallback() override {
+            Nan::HandleScope scope;
+            v8::Local<v8::Value> argv[] = { Nan::Null(), to_js(recs_) };
+            callback->Call(2, argv, async_resource);
+        }
+    };
+
+    NAN_METHOD(GenerateAsync){
+        Args a;
+        int last = info.Length()-1;
+        if(last<0 || !info[last]->IsFunction()){ Nan::ThrowTypeError("last argument must be a callback"); return; }
+        if(!read_args(info, last, a)) return;
+        auto* cb = new Nan::Callback(info[last].As<v8::Function>());
+        Nan::AsyncQueueWorker(new GenerateWorker(cb, a));
+    }
+
+    NAN_METHOD(GenerateInRange){
+        Args a;
+        const char* usage = "usage: generateInRange(count, seed, minDifficulty, maxDifficulty)";
+        if(!read_count_seed(info, info.Length(), a, usage)) return;
+        if(info.Length()<4 || !info[2]->IsNumber() || !info[3]->IsNumber()){ Nan::ThrowTypeError(usage); return; }
+        a.min_diff = Nan::To<double>(info[2]).FromJust();
+        a.max_diff = Nan::To<double>(info[3]).FromJust();
+        try{
+            info.GetReturnValue().Set(to_js(expo::generate_in_range(a.count, a.seed, a.min_diff, a.max_diff)));
+        }catch(const std::exception& e){ Nan::ThrowRangeError(e.what()); }
+    }
+
+    NAN_METHOD(Capacity){
+        Args a;
+        if(!read_levels(info, info.Length(), 0, a)) return;
+        try{ info.GetReturnValue().Set(Nan::New((double)expo::capacity(a.min_level, a.max_level))); }
+        catch(const std::exception& e){ Nan::ThrowRangeError(e.what()); }
+    }
+
+    NAN_MODULE_INIT(Init){
+        Nan::Set(target, Nan::New("generate").ToLocalChecked(),
+                 Nan::GetFunction(Nan::New<v8::FunctionTemplate>(Generate)).ToLocalChecked());
+        Nan::Set(target, Nan::New("generateAsync").ToLocalChecked(),
+                 Nan::GetFunction(Nan::New<v8::FunctionTemplate>(GenerateAsync)).ToLocalChecked());
+        Nan::Set(target, Nan::New("generateInRange").ToLocalChecked(),
+                 Nan::GetFunction(Nan::New<v8::FunctionTemplate>(GenerateInRange)).ToLocalChecked());
+        Nan::Set(target, Nan::New("capacity").ToLocalChecked(),
+                 Nan::GetFunction(Nan::New<v8::FunctionTemplate>(Capacity)).ToLocalChecked());
+        Nan::Set(target, Nan::New("apiVersion").ToLocalChecked(), Nan::New(expo::API_VERSION));
+    }
+
+    } // namespace
+
+    NODE_MODULE(expo_addon, Init)
@@ -0,0 +1,75 @@
+/*  expo_addon_bench.js  ─────────  questions/sec: native addon vs. JSONL
+    usage:  node expo_addon_bench.js [FILE.jsonl] [--count N] [--runs R]
+
+    Times expo.generate(N, seed) against loading N questions from a
+    JSONL file (whole-file read + JSON.parse per line, and a readline
+    stream).  Without FILE the addon's own output is written to a temp
+    file first, so both sides produce the same questions.            */
+const fs = require('fs');
+const os = require('os');
+const path = require('path');
+const readline = require('readline');
+const expo = require('./build/Release/expo_addon.node');
+
+function parseArgs(argv) {
+  const opts = { file: null, count: 10000, runs: 5 };
+  for (let i = 0; i < argv.length; i++) {
+    if (argv[i] === '--count') opts.count = Number(argv[++i]);
+    else if (argv[i] === '--runs') opts.runs = Number(argv[++i]);
+    else opts.file = argv[i];
+  }
+  return opts;
+}
+
+async function best(runs, fn) {
+  let min = Infinity, n = 0;
+  for (let r = 0; r < runs; r++) {
+    const t0 = process.hrtime.bigint();
+    n = await fn(r);
+    min = Math.min(min, Number(process.hrtime.bigint() - t0) / 1e9);
+  }
+  return { secs: min, n };
+}
+
+function readWhole(file, count) {
+  const lines = fs.readFileSync(file, 'utf8').split('\n');
+  const out = [];
+  for (const line of lines) {
+    if (out.length === count) break;
+    if (line) out.push(JSON.parse(line));
+  }
+  return out.length;
+}
+
+async function readStream(file, count) {
+  const rl = readline.createInterface({ input: fs.createReadStream(file), crlfDelay: Infinity });
+  const out = [];
+  for await (const line of rl) {
+    if (line) out.push(JSON.parse(line));
+    if (out.length === count) { rl.close(); break; }
+  }
+  return out.length;
+}
+
+async function main() {
+  const opts = parseArgs(process.argv.slice(2));
+  let file = opts.file;
+  if (!file) {
+    file = path.join(os.tmpdir(), `expo_bench_${process.pid}.jsonl`);
+    const lines = expo.generate(opts.count, 1).map(q => JSON.stringify(q));
+    fs.writeFileSync(file, lines.join('\n') + '\n');
+  }
+
+  const rows = [
+    ['addon generate()', await best(opts.runs, r => expo.generate(opts.count, r + 1).length)],
+    ['JSONL readFileSync', await best(opts.runs, () => readWhole(file, opts.count))],
+    ['JSONL readline', await best(opts.runs, () => readStream(file, opts.count))],
+  ];
+  if (!opts.file) fs.unlinkSync(file);
+
+  console.log(`best of ${opts.runs} runs, ${opts.count} questions requested`);
+  for (const [name, { secs, n }] of rows)
+    console.log(`${name.padEnd(20)} ${String(n).padStart(8)} q  ${(secs * 1e3).toFixed(1).padStart(8)} ms  ${Math.round(n / secs).toLocaleString('en-US').padStart(12)} q/s`);
+}
+
+main().catch(err => { console.error(err); process.exit(1); });
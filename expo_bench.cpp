@@ -0,0 +1,299 @@
+/*  expo_bench.cpp  ─────────  hot-path benchmarks, JSON out
+    compile:  g++ -std=c++20 -O2 -pthread expo_bench.cpp -o expo_bench
+    usage:    expo_bench [--min-time SEC] [--out FILE]
+
+    Builds the library and CLI sources into one unit (the CLI's main()
+    is compiled out with EXPO_GEN_NO_MAIN) so file-local scorers and
+    runners can be timed directly.
+
+    micro   section 0 string scorers next to the section 0b kernels that
+            replaced them, plus diff_on_fraction, diff_power, rational_ok
+            and pow_frac, on operands taken from the real pools: powers
+            of pool numerators / denominators up to 2401 for the digit
+            scorers, pool bases × reachable exponents for the rest.
+    macro   generate_one() per Form, draw_one() and draw_adaptive() +
+            render into a QText, generate_at_level(), the arithmetic
+            family's at(), the --levels quantile sketch, and the full
+            expo_gen loop (draw, dedup, JSONL to /dev/null) at 1, 2, 4,
+            ... threads up to the core count, per --proposal.
+
+    Every entry reports ns per op and heap allocations per op (global
+    operator new is counted).  JSON goes to stdout or --out, a one-line
+    summary per entry to stderr.                                        */
+    #define EXPO_GEN_NO_MAIN
+    #include "expo_core.cpp"
+    #include "arith_core.cpp"
+    #include "exponent_generator.cpp"
+    #include <chrono>
+    #include <fstream>
+    #include <new>
+    #include <set>
+    #include <sstream>
+
+    /* allocation counter: every operator new in the process.  GCC flags
+       inlined new/free pairs as mismatched; they are malloc/free here. */
+    #pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+    static std::atomic<long long> g_allocs{0};
+    void* operator new(std::size_t n){
+        g_allocs.fetch_add(1, std::memory_order_relaxed);
+        if(void* p = std::malloc(n ? n : 1)) return p;
+        throw std::bad_alloc();
+    }
+    void operator delete(void* p) noexcept { std::free(p); }
+    void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+    void* operator new[](std::size_t n){ return operator new(n); }
+    void operator delete[](void* p) noexcept { std::free(p); }
+    void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+
+    namespace bench {
+
+    using Clock = std::chrono::steady_clock;
+    double g_min_time = 0.3;                // seconds per entry
+    volatile double g_sink = 0;             // keeps results alive
+
+    struct Result{
+        std::string group, name;
+        long long ops = 0;
+        double seconds = 0;
+        long long allocs = 0;
+    };
+    std::vector<Result> g_results;
+
+    void report(const Result& r){
+        g_results.push_back(r);
+        double ns = r.seconds*1e9/r.ops;
+        std::fprintf(stderr, "%-5s %-34s %12.1f ns/op %14.0f op/s %8.2f allocs/op\n",
+                     r.group.c_str(), r.name.c_str(), ns, r.ops/r.seconds, (double)r.allocs/r.ops);
+    }
+
+    /* repeats pass() (which does `per_pass` ops) until g_min_time passed */
+    template<class F>
+    void run(const char* group, const char* name, long long per_pass, F pass){
+        pass();                                         // warm caches, first-use statics
+        Result r{group, name};
+        long long a0 = g_allocs.load();
+        auto t0 = Clock::now();
+        do{
+            pass();
+            r.ops += per_pass;
+            r.seconds = std::chrono::duration<double>(Clock::now()-t0).count();
+        }while(r.seconds < g_min_time);
+        r.allocs = g_allocs.load() - a0;
+        report(r);
+    }
+
+    /*───────────────────────────────────────────────────────────────────*/
+    /*  operand sets                                                     */
+    constexpr std::size_t N = 4096;
+
+    /* |numerator| and denominator powers the scorers meet: p^k ≤ 2401 */
+    std::vector<long long> pool_magnitudes(){
+        std::set<long long> v;
+        for(const Frac& b: all_bases)
+            for(long long p: {cabs(b.n), b.d})
+                for(long long x=p; p>1 && x<=2401; x*=p) v.insert(x);
+        v.insert(1);
+        return {v.begin(), v.end()};
+    }
+
+    struct Operands{
+        std::vector<std::pair<long long,long long>> add, sub, mul, div;
+        std::vector<std::pair<Frac,Frac>> frac;         // diff_on_fraction
+        std::vector<char> op;
+        std::vector<std::pair<Frac,Frac>> power;        // base, exponent (all)
+        std::vector<std::pair<Frac,Frac>> power_ok;     // ... that pass rational_ok
+    };
+
+    Operands make_operands(std::uint64_t seed){
+        std::mt19937_64 rng(seed);
+        std::vector<long long> mag = pool_magnitudes();
+        std::uniform_int_distribution<std::size_t> pm(0, mag.size()-1), pb(0, NBASE-1), pe(0, NEXPSET-1);
+        std::uniform_int_distribution<int> sign(0,1), pop(0,3);
+        auto m = [&]{ return mag[pm(rng)]; };
+        auto s = [&](long long x){ return sign(rng)? -x : x; };
+        Operands o;
+        while(o.add.size()<N) o.add.push_back({s(m()), s(m())});
+        while(o.sub.size()<N){
+            long long a = s(m()), b = s(m());
+            if(kern::sub_defined(a,b)) o.sub.push_back({a,b});
+        }
+        while(o.mul.size()<N) o.mul.push_back({m(), m()});
+        while(o.div.size()<N){
+            long long d = m();
+            if(d<=256) o.div.push_back({m()*(1+pm(rng)%8), d});
+        }
+        std::vector<Frac> vals;                         // bases and the powers they reach
+        for(const PowEntry& p: pow_tab) if(p.ok) vals.push_back({p.n, p.d});
+        for(const Frac& b: all_bases) vals.push_back(b);
+        std::uniform_int_distribution<std::size_t> pv(0, vals.size()-1);
+        while(o.frac.size()<N){
+            o.frac.push_back({vals[pv(rng)], vals[pv(rng)]});
+            o.op.push_back("*/+-"[pop(rng)]);
+        }
+        while(o.power.size()<N){
+            Frac b = all_bases[pb(rng)], e = exp_set.e[pe(rng)];
+            o.power.push_back({b,e});
+            if(rational_ok(b,e) && o.power_ok.size()<N) o.power_ok.push_back({b,e});
+        }
+        while(o.power_ok.size()<N){
+            Frac b = all_bases[pb(rng)], e = exp_set.e[pe(rng)];
+            if(rational_ok(b,e)) o.power_ok.push_back({b,e});
+        }
+        return o;
+    }
+
+    /*───────────────────────────────────────────────────────────────────*/
+    void micro(const Operands& o){
+        run("micro", "addition_diff", N, [&]{
+            double t = 0; for(auto [a,b]: o.add) t += addition_diff(a,b); g_sink = t; });
+        run("micro", "kern::add_q", N, [&]{
+            long long t = 0; for(auto [a,b]: o.add) t += kern::add_q(a,b); g_sink = t; });
+        run("micro", "subtraction_diff", N, [&]{
+            double t = 0; for(auto [a,b]: o.sub) t += subtraction_diff(a,b); g_sink = t; });
+        run("micro", "kern::sub_q", N, [&]{
+            long long t = 0; for(auto [a,b]: o.sub) t += kern::sub_q(a,b); g_sink = t; });
+        run("micro", "mul_diff", N, [&]{
+            double t = 0; for(auto [a,b]: o.mul) t += mul_diff(a,b).second; g_sink = t; });
+        run("micro", "kern::mul_q", N, [&]{
+            long long t = 0; for(auto [a,b]: o.mul) t += kern::mul_q(a,b).q; g_sink = t; });
+        run("micro", "div_diff", N, [&]{
+            double t = 0; for(auto [a,b]: o.div) t += div_diff(a,b); g_sink = t; });
+        run("micro", "kern::div_q", N, [&]{
+            long long t = 0; for(auto [a,b]: o.div) t += kern::div_q(a,b); g_sink = t; });
+        run("micro", "diff_on_fraction", N, [&]{
+            double t = 0;
+            for(std::size_t i=0;i<N;++i){
+                try{ t += diff_on_fraction(o.op[i], o.frac[i].first, o.frac[i].second).second; }
+                catch(const std::length_error &){}      // subtraction scorer has no value
+            }
+            g_sink = t; });
+        run("micro", "diff_power", N, [&]{
+            double t = 0; for(auto& [b,e]: o.power_ok) t += diff_power(b,e); g_sink = t; });
+        run("micro", "rational_ok", N, [&]{
+            int t = 0; for(auto& [b,e]: o.power) t += rational_ok(b,e); g_sink = t; });
+        run("micro", "pow_frac", N, [&]{
+            long long t = 0; for(auto& [b,e]: o.power_ok) t += pow_frac(b,e).n; g_sink = t; });
+        run("micro", "pow_exact", N, [&]{
+            long long t = 0;
+            for(auto& [b,e]: o.power_ok){
+                Frac v;  telemetry::Reject why;
+                if(pow_exact(b,e,256,v,why)) t += v.n;
+            }
+            g_sink = t; });
+    }
+
+    void macro(){
+        constexpr int PER_PASS = 10'000;
+        std::mt19937_64 rng(1);
+        for(int f=0;f<4;++f){
+            std::array<double,4> w{};  w[f] = 1;
+            std::discrete_distribution<int> only(w.begin(), w.end());
+            std::string name = std::string("generate_one ") + form_names[f];
+            run("macro", name.c_str(), PER_PASS, [&]{
+                std::size_t t = 0;
+                for(int i=0;i<PER_PASS;++i) t += generate_one(rng, &only).expr.size();
+                g_sink = t; });
+        }
+        run("macro", "generate_one (uniform forms)", PER_PASS, [&]{
+            std::size_t t = 0;
+            for(int i=0;i<PER_PASS;++i) t += generate_one(rng).expr.size();
+            g_sink = t; });
+        run("macro", "draw_one + render to QText (uniform forms)", PER_PASS, [&]{
+            std::size_t t = 0;
+            QText text;
+            for(int i=0;i<PER_PASS;++i){ render(draw_one(rng), text);  t += text.expr_len; }
+            g_sink = t; });
+        run("macro", "draw_adaptive + render to QText", PER_PASS, [&]{
+            std::size_t t = 0;
+            QText text;
+            for(int i=0;i<PER_PASS;++i){ render(draw_adaptive(rng), text);  t += text.expr_len; }
+            g_sink = t; });
+        run("macro", "generate_at_level 1..15", PER_PASS, [&]{
+            std::size_t t = 0;
+            for(int i=0;i<PER_PASS;++i) t += generate_at_level(rng, 1+i%15).expr.size();
+            g_sink = t; });
+        std::uint64_t arithIndex = 0;
+        run("macro", "arithmetic at() (question_generator.py port)", PER_PASS, [&]{
+            std::size_t t = 0;
+            for(int i=0;i<PER_PASS;++i) t += arithmetic_family().at(0, arithIndex++).expr.size();
+            g_sink = t; });
+        /* one sketch across passes: the steady state of a long run */
+        std::vector<double> diffs(PER_PASS);
+        for(int i=0;i<PER_PASS;++i) diffs[i] = arithmetic_family().at(1, i).difficulty;
+        kll::Sketch sketch;
+        run("macro", "kll::Sketch::update (--levels)", PER_PASS, [&]{
+            for(double d: diffs) sketch.update(d);
+            g_sink = sketch.count(); });
+
+        /* the expo_gen main loop, output discarded */
+        int devnull = ::open("/dev/null", O_WRONLY);
+        if(devnull<0) throw std::runtime_error("cannot open /dev/null");
+        std::vector<int> threadCounts;          // 1, 2, 4, ... and the core count: the scaling curve
+        int cores = std::max(1u, std::thread::hardware_concurrency());
+        for(int t=1;t<cores;t*=2) threadCounts.push_back(t);
+        threadCounts.push_back(cores);
+        for(Proposal p: {Proposal::UNIFORM, Proposal::ADAPTIVE})
+            for(long long count: {10'000LL, 40'000LL})
+                for(int threads: threadCounts){
+                    std::string name = "main loop " + std::to_string(count) + " q, "
+                                     + std::to_string(threads) + (threads==1? " thread" : " threads")
+                                     + (p==Proposal::ADAPTIVE? ", adaptive" : "");
+                    std::uint64_t seed = 1;
+                    run("macro", name.c_str(), count, [&]{
+                        Sink sink;
+                        sink.jsonl = std::make_unique<JsonlWriter>(devnull);
+                        run_sharded(sink, exponent_family(p), count, seed++, threads, 0);
+                        sink.close(); });
+                }
+        ::close(devnull);
+    }
+
+    std::string json_escape(const std::string& s){
+        std::string o;
+        for(char c: s){ if(c=='"' || c=='\\') o += '\\'; o += c; }
+        return o;
+    }
+
+    std::string to_json(){
+        std::ostringstream js;
+        js.precision(6);
+        js<<"{\n  \"min_time_s\": "<<g_min_time
+          <<",\n  \"threads\": "<<std::thread::hardware_concurrency()
+          <<",\n  \"compiler\": \""<<json_escape(__VERSION__)<<"\""
+          <<",\n  \"results\": [\n";
+        for(std::size_t i=0;i<g_results.size();++i){
+            const Result& r = g_results[i];
+            js<<"    {\"group\": \""<<r.group<<"\", \"name\": \""<<json_escape(r.name)
+              <<"\", \"ops\": "<<r.ops<<", \"seconds\": "<<r.seconds
+              <<", \"ns_per_op\": "<<r.seconds*1e9/r.ops
+              <<", \"ops_per_sec\": "<<r.ops/r.seconds
+              <<", \"allocs_per_op\": "<<(double)r.allocs/r.ops<<"}"
+              <<(i+1<g_results.size()? ",\n" : "\n");
+        }
+        js<<"  ]\n}\n";
+        return js.str();
+    }
+
+    } // namespace bench
+
+    int main(int argc, char** argv){
+        const char* out = nullptr;
+        for(int i=1;i+1<argc;i+=2){
+            if(!std::strcmp(argv[i],"--min-time"))  bench::g_min_time = std::atof(argv[i+1]);
+            else if(!std::strcmp(argv[i],"--out"))  out = argv[i+1];
+            else{ std::cerr<<"unknown option "<<argv[i]<<"\n"; return 1; }
+        }
+        if(argc%2==0 || bench::g_min_time<=0){
+            std::cerr<<"usage: expo_bench [--min-time SEC] [--out FILE]\n"; return 1;
+        }
+        try{
+            bench::micro(bench::make_operands(42));
+            bench::macro();
+        }catch(const std::exception& e){ std::cerr<<e.what()<<"\n"; return 1; }
+
+        std::string js = bench::to_json();
+        if(!out){ std::cout<<js; return 0; }
+        std::ofstream f(out);
+        if(!(f<<js)){ std::cerr<<"cannot write "<<out<<"\n"; return 1; }
+        return 0;
+    }
@@ -0,0 +1,1254 @@
+/*  expo_core.cpp  ─────────  the generator proper, as a library
+    Scorers, precomputed tables, generate_one(), dedup keys, enumeration
+    and the expo:: API declared in expo_core.h.  Linked into expo_gen
+    and into the Node addon (binding.gyp).                              */
+
+    #include "expo_core.h"
+    #include "expo_telemetry.h"
+    #include "question_family.h"
+    #include "difficulty_kernels.h"
+    #include <iostream>
+    #include <string>
+    #include <vector>
+    #include <array>
+    #include <random>
+    #include <utility>
+    #include <numeric>      // std::gcd
+    #include <cmath>
+    #include <cstdint>
+    #include <initializer_list>
+    #include <cstdlib>
+    #include <cstring>
+    #include <stdexcept>
+    #include <algorithm>
+    #include <charconv>
+    #include <climits>
+    
+    #if __cplusplus < 201703L
+    // ---------------------------------------------------------------------------
+    // Fallback gcd/lcm for pre-C++17 compilers (put inside std namespace to mimic
+    // the real symbols so existing code remains unchanged).
+    // ---------------------------------------------------------------------------
+    namespace std {
+        template <typename T>
+        constexpr T gcd(T a, T b) {
+            while (b != 0) {
+                T t = a % b;
+                a = b;
+                b = t;
+            }
+            return a < 0 ? -a : a;   // always non-negative
+        }
+        template <typename T>
+        constexpr T lcm(T a, T b) {
+            return (a / gcd(a, b)) * b;
+        }
+    } // namespace std
+    #endif
+
+    namespace expo::detail {
+
+    /*───────────────────────────────────────────────────────────────────*/
+    /*  0.  original +-×÷ difficulty helpers (verbatim from your file)  */
+    /*      kept as the reference for --check-kernels; the generator
+            itself scores through the integer kernels in section 0b.    */
+    double addition_diff(long long a,long long b){
+        std::string s1=std::to_string(a),s2=std::to_string(b);
+        double base=0.5*std::min(s1.size(),s2.size());
+        int n=std::max(s1.size(),s2.size());
+        s1.insert(s1.begin(),n-s1.size(),'0');
+        s2.insert(s2.begin(),n-s2.size(),'0');
+        int carry=0,cnt=0;
+        for(int i=n-1;i>=0;--i)
+            if((s1[i]-'0')+(s2[i]-'0')+carry>=10){cnt++;carry=1;}else carry=0;
+        return base+0.75*cnt;
+    }
+    double subtraction_diff(long long a,long long b){
+        if(a>b) std::swap(a,b);
+        std::string small=std::to_string(a),big=std::to_string(b);
+        double base=0.5*small.size();
+        small.insert(small.begin(),big.size()-small.size(),'0');
+        int borrow=0,cnt=0;
+        for(int i=big.size()-1;i>=0;--i){
+            int top=(big[i]-'0')-borrow;
+            if(top<(small[i]-'0')){cnt++;borrow=1;}else borrow=0;
+        }
+        return base+0.75*cnt;
+    }
+    std::pair<long long,double> multiply_one_digit(int d,long long num){
+        std::string s=std::to_string(num);
+        double chunk=0, add=0; long long total=0;
+        for(int i=s.size()-1;i>=0;--i){
+            chunk+=0.5;
+            long long part=1LL*d*(s[i]-'0')*
+                           static_cast<long long>(std::pow(10,s.size()-1-i));
+            if(total){add+=addition_diff(total,part); total+=part;} else total=part;
+        }
+        return {total,chunk+add};
+    }
+    std::vector<std::pair<int,int>> decompose(long long n){
+        std::string s=std::to_string(n);
+        std::vector<std::pair<int,int>> v;
+        for(int i=0;i<s.size();++i) if(s[i]!='0')
+            v.push_back({s[i]-'0',(int)s.size()-1-i});
+        return v;
+    }
+    std::pair<long long,double> mul_diff(long long A,long long B){
+        double subtotal=0,add=0; long long total=0;
+        for(auto [core,z]:decompose(A)){
+            auto [val,d]=multiply_one_digit(core,B);
+            subtotal+=d; val*=static_cast<long long>(std::pow(10,z));
+            if(total){add+=addition_diff(total,val); total+=val;} else total=val;
+        }
+        return {total, subtotal+add};
+    }
+    double div_diff(long long dividend,long long divisor){
+        double diff=0; long long rem=0;
+        for(char ch: std::to_string(dividend)){
+            rem=rem*10+(ch-'0');
+            if(rem<divisor) continue;
+            diff+=subtraction_diff(rem,divisor);
+            rem-=divisor;
+        }
+        return diff;
+    }
+    /*───────────────────────────────────────────────────────────────────*/
+    /*  0b. allocation-free integer kernels: difficulty_kernels.h        */
+    /*───────────────────────────────────────────────────────────────────*/
+    /*  1.  fraction & utility structs                                   */
+    struct Frac { long long n{0}, d{1}; };           // n / d,  d>0
+    
+    constexpr long long cabs(long long x){ return x<0? -x : x; }   // constexpr llabs
+
+    constexpr Frac reduce(Frac f){
+        long long g = std::gcd(cabs(f.n), f.d);
+        f.n /= g; f.d /= g;
+        if (f.d < 0){ f.d = -f.d; f.n = -f.n; }
+        return f;
+    }
+    double value(const Frac& f){ return static_cast<double>(f.n)/f.d; }
+    
+    /* wraps on overflow, as the original did; only the scorers use it
+       (diff_power mirrors the legacy intermediate values)            */
+    constexpr long long llpow(long long b,long long e){
+        long long res=1;
+        while(e){ if(e&1) res=kern::wrap_mul(res,b); b=kern::wrap_mul(b,b); e>>=1; }
+        return res;
+    }
+    /* exact integer rational layer ---------------------------------- */
+    /* No floating point: powers are overflow-checked, roots are exact or
+       refused, and pow_exact() stops as soon as a component passes the
+       bound the caller will filter on anyway.                         */
+    constexpr bool ipow_checked(long long b,long long e,long long& out){
+        long long res=1;
+        while(e-- >0) if(__builtin_mul_overflow(res,b,&res)) return false;
+        out=res; return true;
+    }
+    /* |b|^e, false as soon as it passes limit */
+    constexpr bool ipow_bounded(long long b,long long e,long long limit,long long& out){
+        long long res=1, ab=cabs(b);
+        while(e-- >0) if(__builtin_mul_overflow(res,ab,&res) || res>limit) return false;
+        out=res; return true;
+    }
+    constexpr long long iroot_floor(long long x,int k){        // x >= 0
+        long long lo=0, hi=(k==1)? x : std::min(x, 1LL<<(63/k+1));
+        while(lo<hi){
+            long long mid=lo+(hi-lo+1)/2, p;
+            if(ipow_checked(mid,k,p) && p<=x) lo=mid; else hi=mid-1;
+        }
+        return lo;
+    }
+    /* k-th root rounded to nearest (x >= 0); agrees with
+       llround(pow(x,1.0/k)) whenever x is a perfect k-th power      */
+    constexpr long long iroot_nearest(long long x,int k){
+        if(k<=1 || x<=1) return x;
+        long long r=iroot_floor(x,k);
+        unsigned __int128 lhs=(unsigned __int128)x, rhs=1;
+        for(int i=0;i<k;++i){ lhs*=2; rhs*=(unsigned __int128)(2*r+1); }
+        return lhs>=rhs? r+1 : r;                 // x >= (r+1/2)^k
+    }
+    constexpr bool iroot_exact(long long x,int k,long long& r){   // x >= 0
+        if(k==1){ r=x; return true; }
+        r=iroot_floor(x,k);
+        long long p;
+        return ipow_checked(r,k,p) && p==x;
+    }
+    /* b^e for a reduced exponent, taking the root first so nothing
+       overflows on the way to the bound.  false (and why) when the root
+       is not exact, a negative base meets an odd root of an odd power
+       (the original's pow() gave NaN there), or |numerator| or the
+       denominator passes limit.                                      */
+    constexpr bool pow_exact(Frac b,const Frac& e,long long limit,Frac& out,telemetry::Reject& why){
+        if(b.d<0){ b.n=-b.n; b.d=-b.d; }
+        long long p=cabs(b.n), q=b.d, absn=cabs(e.n);
+        if(e.d!=1){
+            if(!iroot_exact(p,(int)e.d,p) || !iroot_exact(q,(int)e.d,q)
+               || (b.n<0 && e.d%2==0)){ why=telemetry::IRRATIONAL; return false; }
+            if(b.n<0 && absn%2){ why=telemetry::BAND; return false; }
+        }
+        if(!ipow_bounded(p,absn,limit,p) || !ipow_bounded(q,absn,limit,q)){
+            why=telemetry::COMPONENT; return false;
+        }
+        if(b.n<0 && absn%2) p=-p;
+        if(e.n<0) std::swap(p,q);
+        out = reduce({p,q});
+        return true;
+    }
+    /* 1/256 <= |f| <= 256, in integers (f.d > 0) */
+    constexpr bool in_band(const Frac& f){
+        return 256*cabs(f.n)>=f.d && cabs(f.n)<=256*f.d;
+    }
+    /* helper: difficulty of repeating mul base × … × base (k factors)  */
+    constexpr double diff_repeat_mul(long long b,int k){
+        if(k<=1) return 0;
+        long long ab=cabs(b);
+        return (k-1)*kern::to_diff(kern::mul_q(ab,ab).q);   // k-1 identical steps
+    }
+    /* numerator+denominator variant for fractional base                */
+    constexpr double diff_repeat_mul_frac(long long p,long long q,int k){
+        return diff_repeat_mul(p,k)+diff_repeat_mul(q,k);
+    }
+    /*───────────────────────────────────────────────────────────────*/
+    /*  NEW helper: difficulty on fraction arithmetic                */
+    /*───────────────────────────────────────────────────────────────*/
+    constexpr std::pair<Frac,double> diff_on_fraction(char op,const Frac& a,const Frac& b){
+        // Ensure denominators positive
+        auto make_pos = [](const Frac& f){ Frac r=f; if(r.d<0){ r.d=-r.d; r.n=-r.n;} return r; };
+        Frac A = make_pos(a); Frac B = make_pos(b);
+
+        if(op=='+' || op=='-'){
+            long long lcd = std::lcm(A.d, B.d);
+            double lcdCost = (lcd==A.d && lcd==B.d)? 0.0 : kern::to_diff(kern::add_q(A.d, B.d));
+
+            long long scaledA = A.n * (lcd / A.d);
+            long long scaledB = B.n * (lcd / B.d);
+
+            long long N;
+            double coreCost;
+            if(op=='+'){
+                N = scaledA + scaledB;
+                coreCost = kern::to_diff(kern::add_q(scaledA, scaledB));
+            }else{ // '-'
+                N = scaledA - scaledB;
+                coreCost = kern::to_diff(kern::sub_q(scaledA, scaledB));
+            }
+
+            long long D = lcd;
+            long long g = std::gcd(cabs(N), D);
+            double simpCost = 0.0;
+            if(g>1){
+                simpCost = kern::to_diff(kern::div_q(cabs(N), g) + kern::div_q(D, g));
+                N/=g; D/=g;
+            }
+            return { Frac{N,D}, lcdCost + coreCost + simpCost };
+        }
+
+        // Multiplication or division
+        Frac B_eff = B;
+        if(op=='/') { std::swap(B_eff.n, B_eff.d); } // invert b
+
+        // multiply numerators and denominators separately
+        double numCost = kern::to_diff(kern::mul_q(cabs(A.n), cabs(B_eff.n)).q);
+        double denCost = kern::to_diff(kern::mul_q(A.d, B_eff.d).q);
+
+        long long N = A.n * B_eff.n;
+        long long D = A.d * B_eff.d;
+
+        long long g = std::gcd(cabs(N), D);
+        double simpCost = 0.0;
+        if(g>1){
+            simpCost = kern::to_diff(kern::div_q(cabs(N), g) + kern::div_q(D, g));
+            N/=g; D/=g;
+        }
+        return { Frac{N,D}, numCost + denCost + simpCost };
+    }
+    /*───────────────────────────────────────────────────────────────────*/
+    /*  2.  difficulty for b^(n/d)  (atomic, after exponent is final)    */
+    constexpr double diff_power(const Frac& base, const Frac& exp){
+        long long n = exp.n;
+        long long d = exp.d;
+
+        // trivial cases retain old behaviour
+        if(n==0 || (n==1 && d==1)) return 0.5;  // a^0 or a^1
+
+        bool frac_exp = (d!=1);
+        bool negative = (n<0);
+        long long absn = cabs(n);
+
+        // helper lambdas ---------------------------------------------------
+        auto power_cost = [&](long long num,long long den,long long k)->double{
+            if(k<=1) return 0.0;
+            if(den==1) return diff_repeat_mul(num, (int)k);
+            return diff_repeat_mul_frac(num, den, (int)k);
+        };
+
+        auto root_cost = [&](long long num,long long den,int root)->double{
+            long long rNum = iroot_nearest(num, root);
+            long long rDen = iroot_nearest(den, root);
+            return diff_repeat_mul_frac(rNum, rDen, root);
+        };
+
+        //------------------------------------------------------------------
+        // Order A : power first, then root
+        double costA = 0.0;
+        // power step on original base
+        costA += power_cost(cabs(base.n), base.d, absn);
+
+        if(frac_exp){
+            // intermediate base after power
+            long long intNum, intDen;
+            if(base.d==1){
+                intNum = cabs(llpow(base.n,absn));
+                intDen = 1;
+            }else{
+                intNum = llpow(base.n,absn);
+                intDen = llpow(base.d,absn);
+            }
+            costA += root_cost(intNum, intDen, (int)d);
+        }
+
+        // Order B : root first, then power
+        double costB = 0.0;
+        if(frac_exp){
+            // cost of taking root of original base
+            costB += root_cost(cabs(base.n), base.d, (int)d);
+
+            // base after root
+            long long rNum = iroot_nearest(cabs(base.n), (int)d);
+            long long rDen = iroot_nearest(base.d, (int)d);
+
+            costB += power_cost(rNum, rDen, absn);
+        }else{
+            // no root step, same as power first
+            costB = costA;
+        }
+
+        double diff = std::min(costA, costB);
+
+        if(frac_exp) diff += 1;   // single non-integer exponent bump
+        if(negative) diff += 1;   // negative exponent bump
+
+        return diff;
+    }
+    /*───────────────────────────────────────────────────────────────────*/
+    /*  3.  exponent-arithmetic difficulty (nested & chain)              */
+    constexpr double diff_exponent_arith_mul(const Frac& x,const Frac& y){
+        return diff_on_fraction('*', x, y).second;
+    }
+
+    constexpr double diff_exponent_arith_add(std::initializer_list<Frac> list){
+        if(list.size()==0) return 0.0;
+        Frac acc = list.begin()[0];
+        double diff=0.0;
+        for(size_t i=1;i<list.size();++i){
+            char op = (list.begin()[i].n>=0)? '+' : '-';
+            Frac term = list.begin()[i];
+            if(op=='-') term.n = -term.n; // make positive for subtraction
+            auto res = diff_on_fraction(op, acc, term);
+            acc = res.first;
+            diff += res.second;
+        }
+        return diff;
+    }
+    /* same walk, reporting whether the subtraction scorer would throw */
+    constexpr bool exponent_arith_add_defined(std::initializer_list<Frac> list){
+        Frac acc = list.begin()[0];
+        for(size_t i=1;i<list.size();++i){
+            char op = (list.begin()[i].n>=0)? '+' : '-';
+            Frac term = list.begin()[i];
+            if(op=='-'){
+                term.n = -term.n;
+                long long lcd = std::lcm(acc.d, term.d);
+                if(!kern::sub_defined(acc.n*(lcd/acc.d), term.n*(lcd/term.d))) return false;
+            }
+            acc = diff_on_fraction(op, acc, term).first;
+        }
+        return true;
+    }
+    /*───────────────────────────────────────────────────────────────────*/
+    /*  4.  Pools for RNG                                                */
+    constexpr std::array<Frac,24> base_pool = {{
+        {2,1},{3,1},{4,1},{5,1},{6,1},{7,1},{8,1},{9,1},{10,1},
+        {12,1},{16,1},{25,1},{27,1},{32,1},{36,1},{49,1},
+        {1,2},{1,3},{1,4},{1,5},{2,3},{3,4},{3,5},{4,5}
+    }};
+    constexpr std::array<long long,9> neg_int_base = {-2,-3,-4,-5,-6,-7,-8,-9,-10};
+    
+    constexpr std::array<Frac,20> exp_pool = {{
+        {1,1},{2,1},{3,1},{4,1},{5,1},
+        {-1,1},{-2,1},{-3,1},{-4,1},{-5,1},
+        {1,2},{2,3},{3,2},{4,3},{5,2},
+        {-1,2},{-2,3},{-3,2},{-4,3},{-5,2}
+    }};
+    /*───────────────────────────────────────────────────────────────────*/
+    
+    /* the original floating-point rational filter and power, kept as the
+       reference pow_tab is checked against (--check-kernels)          */
+    bool is_perfect_kth(long long x,int k){
+        if(x<0) x=-x;
+        long long r=std::llround(std::pow(x,1.0/k));
+        return llpow(r,k)==x||llpow(r+1,k)==x;
+    }
+    bool rational_ok(const Frac& b,const Frac& e){
+        long long n=e.n,d=e.d;
+        if(b.d==1){
+            long long absb = std::llabs(b.n);
+            if(d!=1 && !is_perfect_kth(absb,(int)d)) return false;
+            if(b.n<0 && d%2==0) return false;
+        }else{
+            long long p=b.n,q=b.d;
+            if(!is_perfect_kth(p,(int)d) || !is_perfect_kth(q,(int)d)) return false;
+        }
+        return true;
+    }
+    Frac pow_frac(const Frac& b,const Frac& e){    // assume rational_ok
+        long long n=e.n,d=e.d;
+        bool neg = (n<0); long long absn = std::llabs(n);
+        // power
+        long long p = llpow(b.n,absn);
+        long long q = llpow(b.d,absn);
+        // root if needed
+        if(d!=1){
+            long long rootP = std::llround(std::pow(static_cast<double>(p), 1.0 / d));
+            long long rootQ = std::llround(std::pow(static_cast<double>(q), 1.0 / d));
+            p = rootP;
+            q = rootQ;
+        }
+        if(neg) std::swap(p,q);
+        return reduce({p,q});
+    }
+    /*───────────────────────────────────────────────────────────────────*/
+    /*  4b. precomputed base × exponent tables (built at compile time)   */
+    /*  Bases are indexed 0..23 for base_pool and 24..32 for neg_int_base.
+        Exponents are indexed into exp_set: exp_pool first (so a pool index
+        is also a set index), then every combined exponent NESTED (x·y)
+        and CHAIN (x+y-z) can reach.  The SIMPLE / NESTED / CHAIN paths of
+        generate_one() only index into these; no pow/llround at run time.  */
+    constexpr int NBASE = base_pool.size() + neg_int_base.size();
+    constexpr int NEXP  = exp_pool.size();
+
+    constexpr std::array<Frac,NBASE> all_bases = []{
+        std::array<Frac,NBASE> a{};
+        for(size_t i=0;i<base_pool.size();++i) a[i]=base_pool[i];
+        for(size_t i=0;i<neg_int_base.size();++i) a[base_pool.size()+i]={neg_int_base[i],1};
+        return a;
+    }();
+    /* index of |base| (the -b^k rendering evaluates the positive base) */
+    constexpr std::array<std::uint8_t,NBASE> abs_base_index = []{
+        std::array<std::uint8_t,NBASE> a{};
+        for(int i=0;i<NBASE;++i){
+            a[i]=(std::uint8_t)i;
+            for(int j=0;j<(int)base_pool.size();++j)
+                if(base_pool[j].d==1 && base_pool[j].n==cabs(all_bases[i].n)) a[i]=(std::uint8_t)j;
+        }
+        return a;
+    }();
+
+    struct ExpSet{                       // reduced n/d, |n| < 128, d < 16
+        std::array<Frac,256> e{}; int n=0;
+        std::array<std::int16_t,256*16> slot{};   // (n+128)*16+d → index+1
+        constexpr int index(const Frac& f) const {
+            if(f.n<=-128 || f.n>=128 || f.d<1 || f.d>=16) throw "exponent outside ExpSet range";
+            return slot[(f.n+128)*16+f.d]-1;
+        }
+        constexpr int add(const Frac& f){
+            int i=index(f); if(i>=0) return i;
+            e[n]=f; slot[(f.n+128)*16+f.d]=(std::int16_t)(n+1);
+            return n++;
+        }
+    };
+    constexpr Frac nested_exp(const Frac& x,const Frac& y){ return reduce({ x.n*y.n , x.d*y.d }); }
+    constexpr Frac chain_exp(const Frac& x,const Frac& y,const Frac& z){
+        long long lcd = std::lcm(x.d, std::lcm(y.d, z.d));
+        return reduce({ x.n*(lcd/x.d) + y.n*(lcd/y.d) - z.n*(lcd/z.d), lcd });
+    }
+    constexpr ExpSet exp_set = []{
+        ExpSet s;
+        for(const Frac& e: exp_pool) s.add(e);
+        for(const Frac& x: exp_pool) for(const Frac& y: exp_pool) s.add(nested_exp(x,y));
+        for(const Frac& x: exp_pool) for(const Frac& y: exp_pool) for(const Frac& z: exp_pool)
+            s.add(chain_exp(x,y,z));
+        return s;
+    }();
+    constexpr int NEXPSET = exp_set.n;
+
+    constexpr std::int16_t quarters(double diff){
+        int q = (int)(diff*4);
+        if(q*0.25!=diff) throw "difficulty is not a multiple of 0.25";
+        return (std::int16_t)q;
+    }
+
+    /* exponent arithmetic: combined exponent index + its difficulty ---- */
+    struct ExpCombo{ std::uint8_t e; bool ok; std::int16_t q; };  // !ok: scorer throws
+    constexpr std::array<ExpCombo,NEXP*NEXP> nested_tab = []{
+        std::array<ExpCombo,NEXP*NEXP> t{};
+        for(int i=0;i<NEXP;++i) for(int j=0;j<NEXP;++j){
+            const Frac &x=exp_pool[i], &y=exp_pool[j];
+            t[i*NEXP+j] = { (std::uint8_t)exp_set.index(nested_exp(x,y)), true,
+                            quarters(diff_exponent_arith_mul(x,y)) };
+        }
+        return t;
+    }();
+    /* CHAIN walks x (+|-) y first; that step is shared by every z     */
+    struct ChainStep{ Frac acc; bool ok; double diff; };
+    constexpr std::array<ChainStep,NEXP*NEXP> chain_step = []{
+        std::array<ChainStep,NEXP*NEXP> t{};
+        for(int i=0;i<NEXP;++i) for(int j=0;j<NEXP;++j){
+            const Frac &x=exp_pool[i], &y=exp_pool[j];
+            ChainStep& c = t[i*NEXP+j];
+            c.ok = exponent_arith_add_defined({x, y});
+            if(!c.ok) continue;
+            c.diff = diff_exponent_arith_add({x, y});
+            c.acc  = diff_on_fraction(y.n>=0? '+' : '-', x, {cabs(y.n), y.d}).first;
+        }
+        return t;
+    }();
+    constexpr std::array<ExpCombo,NEXP*NEXP*NEXP> chain_tab = []{
+        std::array<ExpCombo,NEXP*NEXP*NEXP> t{};
+        for(int i=0;i<NEXP;++i) for(int j=0;j<NEXP;++j) for(int k=0;k<NEXP;++k){
+            const Frac &x=exp_pool[i], &y=exp_pool[j], &z=exp_pool[k];
+            const ChainStep& s = chain_step[i*NEXP+j];
+            ExpCombo& c = t[(i*NEXP+j)*NEXP+k];
+            c.e  = (std::uint8_t)exp_set.index(chain_exp(x,y,z));
+            c.ok = s.ok && exponent_arith_add_defined({s.acc, {-z.n, z.d}});
+            if(c.ok) c.q = quarters(s.diff + diff_exponent_arith_add({s.acc, {-z.n, z.d}}));
+        }
+        return t;
+    }();
+
+    /* b^E: value after every filter generate_one() applies, or !ok and
+       the filter that refused it (why) -------------------------------- */
+    struct PowEntry{ std::int16_t n, d, q; bool ok; std::uint8_t why; };
+    constexpr PowEntry pow_entry(const Frac& b,const Frac& E){
+        auto fail = [](telemetry::Reject why){ return PowEntry{0,1,0,false,why}; };
+        // the old shared tail used E == -1 as the DIFFBASE sentinel, so a
+        // combined exponent of exactly -1 never passed; keep that
+        if(E.d==1 && E.n==-1) return fail(telemetry::EXP_MINUS_ONE);
+        Frac v;
+        telemetry::Reject why = telemetry::ACCEPTED;
+        if(!pow_exact(b,E,256,v,why)) return fail(why);
+        if(!in_band(v)) return fail(telemetry::BAND);
+        return { (std::int16_t)v.n, (std::int16_t)v.d, quarters(diff_power(b,E)), true, telemetry::ACCEPTED };
+    }
+    constexpr std::array<PowEntry,NBASE*NEXPSET> pow_tab = []{
+        std::array<PowEntry,NBASE*NEXPSET> t{};
+        for(int b=0;b<NBASE;++b) for(int k=0;k<NEXPSET;++k)
+            t[b*NEXPSET+k] = pow_entry(all_bases[b], exp_set.e[k]);
+        return t;
+    }();
+    /*───────────────────────────────────────────────────────────────────*/
+    /*  5.  generator for ONE question (may be SIMPLE / NESTED / CHAIN) */
+    /* a^m op b^m : value and difficulty, false (and why) when a filter
+       rejects it.  Every filter runs before any scoring: powers stop at
+       the component bound, and a trap whose subtraction the original
+       scorer could not score (kern::sub_defined) is refused up front.  */
+    bool diffbase_eval(const Frac& aBase,const Frac& bBase,const Frac& mExp,
+                       char op,Frac& val,double& diff,telemetry::Reject& why){
+        if(op=='*' || op=='/'){
+            // combine bases first
+            auto comb = diff_on_fraction(op, aBase, bBase);
+            Frac combinedBase = comb.first;
+            if(!pow_exact(combinedBase,mExp,256,val,why)) return false;
+            if(!in_band(val)){ why = telemetry::BAND; return false; }
+            diff = comb.second + diff_power(combinedBase, mExp);
+        }else{
+            // trap: evaluate separately then add/sub.  Terms are only held
+            // to the magnitude band (64/729 - 1/729 = 7/81 is fine), so
+            // their powers run unbounded; bases and m keep them far from
+            // overflow, which pow_exact() would still refuse.
+            Frac valA, valB;
+            if(!pow_exact(aBase,mExp,INT64_MAX,valA,why) || !pow_exact(bBase,mExp,INT64_MAX,valB,why)
+               || !in_band(valA) || !in_band(valB)){ why = telemetry::TERM_BAND; return false; }
+            if(op=='-'){
+                long long lcd = std::lcm(valA.d, valB.d);
+                if(!kern::sub_defined(valA.n*(lcd/valA.d), valB.n*(lcd/valB.d))){
+                    why = telemetry::SCORER_UNDEFINED; return false;
+                }
+            }
+            auto comb = diff_on_fraction(op, valA, valB);
+            val = comb.first;
+            if(cabs(val.n)>256 || val.d>256){ why = telemetry::COMPONENT; return false; }
+            if(!in_band(val)){ why = telemetry::BAND; return false; }
+            diff = diff_power(aBase, mExp) + diff_power(bBase, mExp) + comb.second;
+        }
+        return true;
+    }
+    /* fill r.n/r.d/r.q for the choices in r; false (and why) if any
+       filter rejects                                                   */
+    static bool evaluate(QRec& r, telemetry::Reject& why){
+        Frac val; double diff;
+        if(r.form==DIFFBASE_SAMEEXP){
+            if(!diffbase_eval(all_bases[r.base], all_bases[r.base2], exp_pool[r.x],
+                              r.op, val, diff, why)) return false;
+        }else{
+            int eIdx = r.x;  double diff_exp_arith = 0;
+            if(r.form==NESTED){
+                const ExpCombo& c = nested_tab[r.x*NEXP+r.y];
+                eIdx = c.e;  diff_exp_arith = kern::to_diff(c.q);
+            }else if(r.form==CHAIN){
+                const ExpCombo& c = chain_tab[(r.x*NEXP+r.y)*NEXP+r.z];
+                if(!c.ok){ why = telemetry::SCORER_UNDEFINED; return false; }
+                eIdx = c.e;  diff_exp_arith = kern::to_diff(c.q);
+            }
+            /* -b^k evaluates the positive base and applies the minus after */
+            const PowEntry& pe = pow_tab[(r.bare? abs_base_index[r.base] : r.base)*NEXPSET+eIdx];
+            if(!pe.ok){ why = (telemetry::Reject)pe.why; return false; }
+            val  = { r.bare? -pe.n : pe.n, pe.d };
+            diff = diff_exp_arith + kern::to_diff(pe.q);
+        }
+        r.n = (std::int16_t)val.n;  r.d = (std::int16_t)val.d;  r.q = quarters(diff);
+        return true;
+    }
+    bool evaluate(QRec& r){
+        telemetry::Reject why;
+        return evaluate(r, why);
+    }
+    /* record → expression / answer text.  Longest expression is a CHAIN
+       of 5-char bases and 4-char exponents (42 chars), longest answer
+       two int16s, so QText's buffers never fill.                       */
+    namespace {
+    struct TextOut{
+        char* p;
+        void put(char c){ *p++ = c; }
+        void put(const char* s){ while(*s) *p++ = *s++; }
+        void num(long long v){ p = std::to_chars(p, p+24, v).ptr; }
+        void frac(const Frac& f){ num(f.n); put('/'); num(f.d); }
+        /* base: negative integers and fractions in parentheses */
+        void base(const Frac& b){
+            if(b.d==1 && b.n>=0){ num(b.n); return; }
+            put('(');
+            if(b.d==1) num(b.n); else frac(b);
+            put(')');
+        }
+        void exp(const Frac& e){ if(e.d==1) num(e.n); else frac(e); }
+    };
+    }
+    void render(const QRec& r, QText& t){
+        EXPO_TICK(t0);
+        TextOut o{t.expr_buf};
+        const Frac& base = all_bases[r.base];
+        if(r.form==SIMPLE){
+            if(r.bare) o.num(base.n); else o.base(base);
+            o.put('^');  o.exp(exp_pool[r.x]);
+        }else if(r.form==NESTED){
+            o.put("((");  o.base(base);
+            o.put(")^");  o.exp(exp_pool[r.x]);
+            o.put(")^");  o.exp(exp_pool[r.y]);
+        }else if(r.form==CHAIN){
+            o.base(base);  o.put("^(");  o.exp(exp_pool[r.x]);  o.put(") * ");
+            o.base(base);  o.put("^(");  o.exp(exp_pool[r.y]);  o.put(") / ");
+            o.base(base);  o.put("^(");  o.exp(exp_pool[r.z]);  o.put(')');
+        }else{
+            o.base(base);  o.put('^');  o.num(exp_pool[r.x].n);
+            o.put(' ');  o.put(r.op);  o.put(' ');
+            o.base(all_bases[r.base2]);  o.put('^');  o.num(exp_pool[r.x].n);
+        }
+        t.expr_len = (std::uint8_t)(o.p - t.expr_buf);
+        o.p = t.ans_buf;
+        o.frac({r.n, r.d});
+        t.ans_len = (std::uint8_t)(o.p - t.ans_buf);
+        EXPO_TOCK(t0, telemetry::RENDER);
+    }
+    void render(const QRec& r, std::string& expr, std::string& ans){
+        QText t;
+        render(r, t);
+        expr.assign(t.expr());
+        ans.assign(t.ans());
+    }
+
+    Question make_question(const QRec& r){
+        Question q = unrendered(r);
+        render(r, q.expr, q.ans);
+        return q;
+    }
+
+    /* pickForm: optional non-uniform form choice (stratified mode) */
+    template<class Rng>
+    QRec draw_one(Rng& rng, std::discrete_distribution<int>* pickForm){
+        std::uniform_int_distribution<int> distForm(0,3);
+        std::uniform_int_distribution<int> bPos(0, base_pool.size()-1);
+        std::uniform_int_distribution<int> bNeg(0, neg_int_base.size()-1);
+        std::uniform_int_distribution<int> ePos(0, exp_pool.size()-1);
+        std::uniform_real_distribution<double> coin(0,1);
+        const int negOff = base_pool.size();    // neg_int_base starts here in all_bases
+        while(true){
+            EXPO_TICK(tSample);
+            QRec r{};
+            /* pick form */
+            r.form = (std::uint8_t)(pickForm? (*pickForm)(rng) : distForm(rng));
+
+            /* pick base (index into all_bases) */
+            if(coin(rng)<0.3){ r.base=negOff+bNeg(rng); }
+            else               r.base=bPos(rng);
+            const Frac& base = all_bases[r.base];
+
+            if(r.form==SIMPLE){
+                r.x = ePos(rng);
+                const Frac& e = exp_pool[r.x];
+                // decide parentheses rule
+                if(base.n<0 && base.d==1){
+                    if(e.d==1){ // integer exponent
+                        double prob = (std::llabs(e.n)%2==0? 0.40 : 0.20);
+                        if(rng() / double(rng.max()) < prob) r.bare=true;
+                    }else if(e.d%2==0){ // even denominator fraction
+                        r.bare=true;
+                    }
+                }
+            }
+            else if(r.form==NESTED){
+                r.x = ePos(rng);  r.y = ePos(rng);
+            }
+            else if(r.form==CHAIN){   /* CHAIN: 3 terms  a^x * a^y / a^z */
+                r.x = ePos(rng);  r.y = ePos(rng);  r.z = ePos(rng);
+            }
+            else{   /* DIFFBASE_SAMEEXP :  a^m *or/ b^m  */
+                // pick integer exponent m
+                r.x = ePos(rng);
+                while(exp_pool[r.x].d!=1){ EXPO_COUNT(r.form, telemetry::EXP_REDRAW);  r.x = ePos(rng); }
+
+                // pick bases a and b
+                r.base = bPos(rng);
+                if(coin(rng)<0.3) r.base = negOff+bNeg(rng);
+                r.base2 = bPos(rng);
+                if(coin(rng)<0.3) r.base2 = negOff+bNeg(rng);
+
+                // decide primary operator (mul/div)
+                bool isMul = (coin(rng)<0.5);
+
+                // decide trap
+                double trapP = 0.1 + (coin(rng)*0.1); // 0.10 to 0.20
+                bool isTrap = (coin(rng) < trapP);
+
+                if(!isTrap){ r.op = isMul ? '*' : '/'; }
+                else{ r.op = (coin(rng)<0.5? '+' : '-'); }
+            }
+
+            EXPO_TOCK(tSample, telemetry::SAMPLE);
+
+            EXPO_TICK(tScore);
+            telemetry::Reject why = telemetry::ACCEPTED;
+            bool ok = evaluate(r, why);
+            EXPO_TOCK(tScore, telemetry::SCORE);
+            EXPO_COUNT(r.form, why);
+            if(!ok) continue;
+            return r;
+        }
+    }
+    template<class Rng>
+    Question generate_one(Rng& rng, std::discrete_distribution<int>* pickForm){
+        return make_question(draw_one(rng, pickForm));
+    }
+    template QRec draw_one(std::mt19937_64&, std::discrete_distribution<int>*);
+    template QRec draw_one(philox::Stream&, std::discrete_distribution<int>*);
+    template Question generate_one(std::mt19937_64&, std::discrete_distribution<int>*);
+    template Question generate_one(philox::Stream&, std::discrete_distribution<int>*);
+
+    /* stream `index` under key `seed`: the rejection loop reads as many
+       blocks as it needs, and no other question touches them          */
+    QRec draw_at(std::uint64_t seed, std::uint64_t index){
+        philox::Stream rng(seed, index);
+        return draw_one(rng);
+    }
+    Question question_at(std::uint64_t seed, std::uint64_t index){
+        return make_question(draw_at(seed, index));
+    }
+
+    class ExponentFamily final : public QuestionFamily{
+        bool adaptive_;
+    public:
+        explicit ExponentFamily(Proposal p) : adaptive_(p==Proposal::ADAPTIVE) {}
+        const char* name() const override { return "exponent"; }
+        /* records only: the runners render what they keep */
+        Question draw(std::mt19937_64& rng) const override {
+            return unrendered(adaptive_? draw_adaptive(rng) : draw_one(rng));
+        }
+        Question at(std::uint64_t seed, std::uint64_t index) const override {
+            if(!adaptive_) return unrendered(draw_at(seed, index));
+            philox::Stream rng(seed, index);
+            return unrendered(draw_adaptive(rng));
+        }
+        std::uint64_t key(const Question& q) const override { return question_key(q.rec); }
+        bool samples_levels() const override { return true; }
+        Question at_level(std::mt19937_64& rng, int level) const override { return unrendered(draw_at_level(rng, level)); }
+        LevelCounts capacity() const override { return level_capacity(); }
+    };
+
+    } // namespace expo::detail
+
+    const QuestionFamily& exponent_family(Proposal p){
+        using expo::detail::ExponentFamily;
+        static const ExponentFamily uniform(Proposal::UNIFORM), adaptive(Proposal::ADAPTIVE);
+        return p==Proposal::ADAPTIVE? adaptive : uniform;
+    }
+
+    namespace expo::detail {
+
+    /*───────────────────────────────────────────────────────────────────*/
+    /*  5b. compact dedup                                                */
+    /*  A question is identified by its choices, not its text: the QRec
+        fields that feed render() pack into one 64-bit key (the answer
+        and difficulty follow from them).  Keys live in a flat
+        open-addressing table, 8 bytes per slot at ≤ 3/4 load; the
+        optional Bloom filter trades a false-positive budget (a new
+        question occasionally taken for a duplicate and skipped) for
+        ~1.44·log2(1/p) bits per question.                              */
+    std::uint64_t question_key(const QRec& r){
+        static constexpr char ops[] = "*/+-";
+        std::uint64_t op = r.op? (std::uint64_t)(std::strchr(ops, r.op)-ops) : 0;
+        return  (std::uint64_t)r.form
+             | ((std::uint64_t)r.bare  << 2)
+             | ((std::uint64_t)r.base  << 3)
+             | ((std::uint64_t)r.base2 << 9)
+             | ((std::uint64_t)r.x     << 15)
+             | ((std::uint64_t)r.y     << 20)
+             | ((std::uint64_t)r.z     << 25)
+             | (op                     << 30)
+             | (1ULL << 63);                     // never 0 (empty slot)
+    }
+    /*───────────────────────────────────────────────────────────────────*/
+    /*  7.  --check-kernels : integer kernels vs. section 0 reference,
+            and the section 4b tables vs. the run-time filter chain       */
+    /*  Exhaustive over the operand boxes generate_one() feeds the scorers
+        at top level (mul: A 0..2401 × B -10..2401, div: divisor 1..256),
+        plus every add/sub pair in -1000..1000; the large add operands
+        only arise inside mul and are covered through it.                */
+    int check_kernels(){
+        long long bad = 0, total = 0;
+        auto report = [&](const char* what,long long a,long long b,double ref,double got){
+            if(ref==got) return;
+            if(++bad<=10) std::cerr<<what<<"("<<a<<","<<b<<"): ref "<<ref<<" got "<<got<<"\n";
+        };
+        for(long long a=-1000;a<=1000;++a)
+            for(long long b=-1000;b<=1000;++b){
+                report("add",a,b,addition_diff(a,b),kern::to_diff(kern::add_q(a,b)));
+                bool refThrows=false; double ref=0;
+                try{ ref=subtraction_diff(a,b); }catch(const std::length_error&){ refThrows=true; }
+                if(refThrows!=!kern::sub_defined(a,b)){ report("sub-throw",a,b,refThrows,!refThrows); continue; }
+                if(!refThrows) report("sub",a,b,ref,kern::to_diff(kern::sub_q(a,b)));
+                total+=2;
+            }
+        for(long long A=0;A<=2401;++A)
+            for(long long B=-10;B<=2401;++B){
+                auto ref=mul_diff(A,B); auto got=kern::mul_q(A,B);
+                report("mul",A,B,ref.second,kern::to_diff(got.q));
+                if(ref.first!=got.total) report("mul-total",A,B,(double)ref.first,(double)got.total);
+                ++total;
+            }
+        for(long long n=-50;n<=100'000;++n)
+            for(long long d=1;d<=256;++d){
+                bool refThrows=false; double ref=0;
+                try{ ref=div_diff(n,d); }catch(const std::length_error&){ refThrows=true; }
+                bool gotThrows=false; double got=0;
+                try{ got=kern::to_diff(kern::div_q(n,d)); }catch(const std::length_error&){ gotThrows=true; }
+                if(refThrows!=gotThrows) report("div-throw",n,d,refThrows,gotThrows);
+                else report("div",n,d,ref,got);
+                ++total;
+            }
+        /* batch entry points against the scalar kernels */
+        std::mt19937_64 r(7);
+        std::uniform_int_distribution<long long> wide(-312'500'000, 882'735'153'125);
+        std::vector<long long> a(1<<16), b(1<<16); std::vector<double> out(1<<16);
+        for(int round=0;round<64;++round){
+            for(size_t i=0;i<a.size();++i){ a[i]=wide(r); b[i]=(i&1)? wide(r) : std::llabs(wide(r)); }
+            kern::add_batch(a.data(),b.data(),out.data(),a.size());
+            for(size_t i=0;i<a.size();++i) report("add_batch",a[i],b[i],kern::to_diff(kern::add_q(a[i],b[i])),out[i]);
+            for(size_t i=0;i<a.size();++i) if(!kern::sub_defined(a[i],b[i])) b[i]=a[i];
+            kern::sub_batch(a.data(),b.data(),out.data(),a.size());
+            for(size_t i=0;i<a.size();++i) report("sub_batch",a[i],b[i],kern::to_diff(kern::sub_q(a[i],b[i])),out[i]);
+            total += 2*a.size();
+        }
+        /* section 4b tables against the run-time filter chain */
+        for(int b=0;b<NBASE;++b) for(int k=0;k<NEXPSET;++k){
+            const Frac &B=all_bases[b], &E=exp_set.e[k];
+            const PowEntry& pe=pow_tab[b*NEXPSET+k];
+            bool ok = !(E.d==1 && E.n==-1) && rational_ok(B,E);
+            Frac v{0,1};
+            if(ok){
+                v = pow_frac(B,E);
+                double mag = std::fabs(value(v));
+                ok = !(std::llabs(v.n)>256 || v.d>256 || mag<1.0/256.0 || mag>256.0);
+            }
+            if(ok!=pe.ok) report("pow_tab-ok",b,k,ok,pe.ok);
+            else if(ok){
+                if(v.n!=pe.n || v.d!=pe.d) report("pow_tab-val",b,k,value(v),(double)pe.n/pe.d);
+                report("pow_tab-diff",b,k,diff_power(B,E),kern::to_diff(pe.q));
+            }
+            ++total;
+        }
+        for(int i=0;i<NEXP;++i) for(int j=0;j<NEXP;++j){
+            const Frac &x=exp_pool[i], &y=exp_pool[j];
+            const ExpCombo& c=nested_tab[i*NEXP+j];
+            Frac E=reduce({x.n*y.n, x.d*y.d});
+            if(exp_set.e[c.e].n!=E.n || exp_set.e[c.e].d!=E.d) report("nested_tab-exp",i,j,value(E),value(exp_set.e[c.e]));
+            report("nested_tab-diff",i,j,diff_exponent_arith_mul(x,y),kern::to_diff(c.q));
+            for(int k=0;k<NEXP;++k){
+                const Frac& z=exp_pool[k];
+                const ExpCombo& t=chain_tab[(i*NEXP+j)*NEXP+k];
+                bool throws=false; double ref=0;
+                try{ ref=diff_exponent_arith_add({x, y, {-z.n, z.d}}); }catch(const std::length_error&){ throws=true; }
+                if(throws==t.ok) report("chain_tab-ok",i*NEXP+j,k,!throws,t.ok);
+                else if(t.ok) report("chain_tab-diff",i*NEXP+j,k,ref,kern::to_diff(t.q));
+                total+=2;
+            }
+        }
+        std::cerr<<"check-kernels: "<<total<<" cases, "<<bad<<" mismatches\n";
+        return check_band_sampler() | (bad? 1 : 0);
+    }
+    /*───────────────────────────────────────────────────────────────────*/
+    /*  8.  exhaustive enumeration                                       */
+    /*  Every form draws from a finite choice space, so walk all of it
+        once and keep what evaluate() accepts.  Distinct records render
+        to distinct expressions: this is exactly the set the random
+        generator's dedup converges to.                                 */
+    const char* const form_names[4] = {"SIMPLE","NESTED","CHAIN","DIFFBASE_SAMEEXP"};
+
+    std::vector<QRec> enumerate_all(){
+        std::vector<QRec> out;
+        auto keep = [&](QRec r){ if(evaluate(r)) out.push_back(r); };
+        for(int b=0;b<NBASE;++b){
+            bool negInt = all_bases[b].n<0;
+            for(int x=0;x<NEXP;++x){
+                const Frac& e = exp_pool[x];
+                QRec r{};  r.form=SIMPLE;  r.base=b;  r.x=x;
+                if(!negInt || e.d%2!=0) keep(r);                 // parenthesised
+                if(negInt && (e.d==1 || e.d%2==0)){ r.bare=true; keep(r); }
+                for(int y=0;y<NEXP;++y){
+                    QRec n{};  n.form=NESTED;  n.base=b;  n.x=x;  n.y=y;
+                    keep(n);
+                    for(int z=0;z<NEXP;++z){
+                        QRec c{};  c.form=CHAIN;  c.base=b;  c.x=x;  c.y=y;  c.z=z;
+                        keep(c);
+                    }
+                }
+            }
+        }
+        for(int m=0;m<NEXP;++m){
+            if(exp_pool[m].d!=1) continue;
+            for(int a=0;a<NBASE;++a) for(int b=0;b<NBASE;++b)
+                for(char op: {'*','/','+','-'}){
+                    QRec r{};  r.form=DIFFBASE_SAMEEXP;  r.base=a;  r.base2=b;  r.x=m;  r.op=op;
+                    keep(r);
+                }
+        }
+        return out;
+    }
+
+    void report_enumeration(const std::vector<QRec>& all){
+        long long perForm[4]{};
+        for(const QRec& r: all) ++perForm[r.form];
+        std::cerr<<"unique questions:";
+        for(int f=0;f<4;++f) std::cerr<<" "<<form_names[f]<<" "<<perForm[f];
+        std::cerr<<", total "<<all.size()<<"\n";
+    }
+
+    /*───────────────────────────────────────────────────────────────────*/
+    /*  8b. sampling at a target difficulty                              */
+    /*  generate_one() draws choices, then rejects what evaluate() refuses,
+        so a question r comes out with probability p(r)/Z, p(r) being the
+        chance one round of draws makes r.  Restricted to a difficulty
+        band that is p(r)/Z_band, which is what filtering generate_one()
+        on the score gives, and what the sampler below returns directly:
+        enumerated records grouped by quarter-point difficulty, one alias
+        table per bucket (Vose), buckets picked by their total p.        */
+    double draw_probability(const QRec& r){
+        const int negOff = base_pool.size();
+        auto pBase = [&](int b){ return b>=negOff? 0.3/neg_int_base.size() : 0.7/base_pool.size(); };
+        double p = 0.25;                                   // form
+        if(r.form==SIMPLE){
+            p *= pBase(r.base) / NEXP;
+            const Frac &b = all_bases[r.base], &e = exp_pool[r.x];
+            if(b.n<0 && b.d==1 && e.d==1){                 // the only coin-flipped parens
+                double bare = (std::llabs(e.n)%2==0? 0.40 : 0.20);
+                p *= r.bare? bare : 1-bare;
+            }
+        }else if(r.form==NESTED){
+            p *= pBase(r.base) / (NEXP*NEXP);
+        }else if(r.form==CHAIN){
+            p *= pBase(r.base) / (NEXP*NEXP*NEXP);
+        }else{
+            int ints = 0;
+            for(const Frac& e: exp_pool) ints += (e.d==1);
+            double trap = 0.15;                            // E[0.10 + 0.10·U]
+            p *= pBase(r.base) * pBase(r.base2) / ints
+               * ((r.op=='*' || r.op=='/')? (1-trap)/2 : trap/2);
+        }
+        return p;
+    }
+
+    class DifficultySampler{
+        std::vector<QRec> rec_;                   // sorted by q
+        int qmin_ = 0, qmax_ = -1;
+        std::vector<std::uint32_t> start_;        // bucket q-qmin_ → rec_[start_[i], start_[i+1])
+        std::vector<double> cum_;                 // cum_[i] = Σ p over buckets < i
+        std::vector<double> prob_;                // per record: keep probability …
+        std::vector<std::uint32_t> alias_;        // … else this record (bucket-relative)
+
+        void build_alias(std::uint32_t lo, std::uint32_t hi, const std::vector<double>& w){
+            std::size_t n = hi-lo;
+            double total = 0;
+            for(std::size_t i=lo;i<hi;++i) total += w[i];
+            std::vector<double> scaled(n);
+            std::vector<std::uint32_t> small, large;
+            for(std::size_t i=0;i<n;++i){
+                scaled[i] = w[lo+i]*n/total;
+                (scaled[i]<1? small : large).push_back(i);
+            }
+            while(!small.empty() && !large.empty()){
+                std::uint32_t s = small.back(), l = large.back();
+                small.pop_back();
+                prob_[lo+s] = scaled[s];  alias_[lo+s] = l;
+                scaled[l] -= 1-scaled[s];
+                if(scaled[l]<1){ large.pop_back(); small.push_back(l); }
+            }
+            for(std::uint32_t i: large) prob_[lo+i] = 1;  // leftovers are 1 up to rounding
+            for(std::uint32_t i: small) prob_[lo+i] = 1;
+        }
+    public:
+        DifficultySampler(){
+            rec_ = enumerate_all();
+            std::stable_sort(rec_.begin(), rec_.end(), [](const QRec& a, const QRec& b){ return a.q<b.q; });
+            if(rec_.empty()) return;
+            qmin_ = rec_.front().q;  qmax_ = rec_.back().q;
+            std::vector<double> w(rec_.size());
+            for(std::size_t i=0;i<rec_.size();++i) w[i] = draw_probability(rec_[i]);
+            prob_.assign(rec_.size(), 1);  alias_.assign(rec_.size(), 0);
+            start_.assign(qmax_-qmin_+2, 0);
+            cum_.assign(qmax_-qmin_+2, 0);
+            std::uint32_t i = 0;
+            for(int q=qmin_;q<=qmax_;++q){
+                std::uint32_t lo = i;
+                double mass = 0;
+                while(i<rec_.size() && rec_[i].q==q) mass += w[i++];
+                start_[q-qmin_+1] = i;
+                cum_[q-qmin_+1] = cum_[q-qmin_] + mass;
+                if(i>lo) build_alias(lo, i, w);
+            }
+        }
+
+        /* clamps [qlo, qhi] to the populated buckets; false if nothing is in it */
+        bool clamp(int& qlo, int& qhi) const {
+            qlo = std::max(qlo, qmin_);  qhi = std::min(qhi, qmax_);
+            return qlo<=qhi && start_[qhi-qmin_+1] > start_[qlo-qmin_];
+        }
+        /* distinct records in [qlo, qhi] (already clamped) */
+        std::size_t size(int qlo, int qhi) const { return start_[qhi-qmin_+1] - start_[qlo-qmin_]; }
+        /* record in [qlo, qhi] (already clamped), ∝ draw_probability */
+        template<class Rng>
+        const QRec& draw(Rng& rng, int qlo, int qhi) const {
+            std::uniform_real_distribution<double> u(cum_[qlo-qmin_], cum_[qhi-qmin_+1]);
+            double x = u(rng);
+            int b = int(std::upper_bound(cum_.begin()+(qlo-qmin_)+1, cum_.begin()+(qhi-qmin_)+1, x)
+                        - cum_.begin()) - 1;
+            while(start_[b+1]==start_[b]) --b;            // x rounded onto the top edge
+            std::uint32_t lo = start_[b], n = start_[b+1]-lo;
+            std::uniform_int_distribution<std::uint32_t> pick(0, n-1);
+            std::uint32_t k = lo + pick(rng);
+            return std::uniform_real_distribution<double>(0,1)(rng) < prob_[k]? rec_[k] : rec_[lo+alias_[k]];
+        }
+        /* quarter-point span of levels lo..hi (level_of is monotone in q) */
+        bool level_span(int lo, int hi, int& qlo, int& qhi) const {
+            qlo = qmax_+1;  qhi = qmin_-1;
+            for(int q=qmin_;q<=qmax_;++q){
+                int l = corpus::level_of(q*0.25);
+                if(l>=lo && l<=hi){ qlo = std::min(qlo,q); qhi = std::max(qhi,q); }
+            }
+            return clamp(qlo, qhi);
+        }
+    };
+
+    const DifficultySampler& difficulty_sampler(){
+        static const DifficultySampler s;       // enumeration + tables, built on first use
+        return s;
+    }
+
+    /* [min_diff, max_diff] as clamped quarter points; false if the band
+       holds no question.  Infinite bounds are fine, NaN or reversed
+       ones throw std::invalid_argument.                                */
+    bool band_quarters(double min_diff, double max_diff, int& qlo, int& qhi){
+        if(std::isnan(min_diff) || std::isnan(max_diff) || min_diff>max_diff)
+            throw std::invalid_argument("difficulty band must satisfy min <= max");
+        constexpr double LIMIT = 1e9;           // far outside any score, inside int
+        qlo = (int)std::clamp(std::ceil(min_diff*4), -LIMIT, LIMIT);
+        qhi = (int)std::clamp(std::floor(max_diff*4), -LIMIT, LIMIT);
+        return difficulty_sampler().clamp(qlo, qhi);
+    }
+
+    Question generate_in_range(std::mt19937_64& rng, double min_diff, double max_diff){
+        int qlo, qhi;
+        if(!band_quarters(min_diff, max_diff, qlo, qhi))
+            throw std::out_of_range("no questions with difficulty in range");
+        return make_question(difficulty_sampler().draw(rng, qlo, qhi));
+    }
+
+    QRec draw_at_level(std::mt19937_64& rng, int level){
+        int qlo, qhi;
+        const DifficultySampler& s = difficulty_sampler();
+        if(!s.level_span(level, level, qlo, qhi))
+            throw std::out_of_range("no questions at level " + std::to_string(level));
+        return s.draw(rng, qlo, qhi);
+    }
+    Question generate_at_level(std::mt19937_64& rng, int level){
+        return make_question(draw_at_level(rng, level));
+    }
+
+    /*  The uniform proposal keeps one draw in four (CHAIN: one in
+        eight).  Skewing it by per-form / per-choice acceptance rates
+        learned in a warm-up gains next to nothing once the output is held
+        to the same distribution: thinning by p/q cancels every skew except
+        dropping a choice that is never accepted, and only one is (SIMPLE
+        with exponent -1; the other choices' rates run 3%..100%).  The
+        rate that matters is the joint one, and the enumeration has it
+        exactly, so the adaptive proposal is the sampler over all buckets:
+        q(r) = p(r)/Z on accepted records and 0 elsewhere, so the
+        importance weight p/q is the constant Z and nothing is thinned.
+        The warm-up is building the tables (~15 ms, once per process).   */
+    template<class Rng>
+    QRec draw_adaptive(Rng& rng){
+        const DifficultySampler& s = difficulty_sampler();
+        int qlo = INT_MIN, qhi = INT_MAX;
+        s.clamp(qlo, qhi);
+        return s.draw(rng, qlo, qhi);
+    }
+    template QRec draw_adaptive(std::mt19937_64&);
+    template QRec draw_adaptive(philox::Stream&);
+
+    /*  --check-kernels, second part: the band sampler against what it
+        stands in for.  In each band, draw_one() filtered on the score and
+        the sampler are each compared with p ∝ draw_probability over the
+        enumerated records in the band: Pearson χ² per record, records
+        expected fewer than 5 times pooled into one cell.  A sample fails
+        if χ² is more than 5σ above its degrees of freedom, or if the
+        sampler leaves the band.                                         */
+    int check_band_sampler(){
+        constexpr long long N = 200'000;
+        const DifficultySampler& s = difficulty_sampler();
+        const std::vector<QRec> all = enumerate_all();
+        std::mt19937_64 rng(11);
+        int bad = 0;
+        for(auto [lo, hi]: {std::pair{0.5, 3.0}, std::pair{5.0, 8.0}, std::pair{9.0, (double)INFINITY}}){
+            int qlo, qhi;
+            if(!band_quarters(lo, hi, qlo, qhi)) continue;
+            std::vector<std::pair<std::uint64_t,double>> p;          // (key, probability), by key
+            for(const QRec& r: all)
+                if(r.q>=qlo && r.q<=qhi) p.emplace_back(question_key(r), draw_probability(r));
+            std::sort(p.begin(), p.end());
+            double z = 0;
+            for(auto& e: p) z += e.second;
+            auto cell = [&](const QRec& r){
+                return std::lower_bound(p.begin(), p.end(), std::pair{question_key(r), -1.0}) - p.begin();
+            };
+            auto test = [&](const char* what, const std::vector<long long>& seen, long long outside){
+                double chi2 = 0, poolE = 0, poolO = 0;
+                long long dof = -1;
+                for(std::size_t i=0;i<p.size();++i){
+                    double e = N*p[i].second/z;
+                    if(e<5){ poolE += e;  poolO += seen[i];  continue; }
+                    chi2 += (seen[i]-e)*(seen[i]-e)/e;  ++dof;
+                }
+                if(poolE>0){ chi2 += (poolO-poolE)*(poolO-poolE)/poolE;  ++dof; }
+                double sigma = (chi2-dof)/std::sqrt(2.0*std::max<long long>(dof,1));
+                bool ok = sigma<5 && !outside;
+                bad += !ok;
+                std::cerr<<"check-sampler: ["<<lo<<", "<<hi<<"] "<<what<<": chi2 "<<chi2<<" on "<<dof
+                         <<" dof ("<<sigma<<" sigma), "<<outside<<" outside"<<(ok? "" : "  MISMATCH")<<"\n";
+            };
+            std::vector<long long> filtered(p.size()), sampled(p.size());
+            for(long long n=0;n<N;){
+                QRec r = draw_one(rng);
+                if(r.q<qlo || r.q>qhi) continue;
+                ++filtered[cell(r)];  ++n;
+            }
+            long long outside = 0;
+            for(long long n=0;n<N;++n){
+                const QRec& r = s.draw(rng, qlo, qhi);
+                if(r.q<qlo || r.q>qhi){ ++outside;  continue; }
+                ++sampled[cell(r)];
+            }
+            test("filtered draw_one", filtered, 0);
+            test("band sampler     ", sampled, outside);
+        }
+        return bad? 1 : 0;
+    }
+
+    /*───────────────────────────────────────────────────────────────────*/
+    /*  8c. per-level capacity and the expo:: API                        */
+    LevelCounts level_capacity(){
+        static const LevelCounts cap = []{     // the enumeration never changes
+            LevelCounts c{};
+            for(const QRec& r: enumerate_all()) ++c[corpus::level_of(kern::to_diff(r.q))];
+            return c;
+        }();
+        return cap;
+    }
+
+    } // namespace expo::detail
+
+    namespace expo {
+
+    using namespace detail;
+
+    static void check_range(int min_level, int max_level){
+        if(min_level<1 || max_level>corpus::LEVELS || min_level>max_level)
+            throw std::invalid_argument("level range must satisfy 1 <= min <= max <= 30");
+    }
+
+    std::size_t capacity(int min_level, int max_level){
+        check_range(min_level, max_level);
+        LevelCounts cap = level_capacity();
+        std::size_t n = 0;
+        for(int l=min_level;l<=max_level;++l) n += cap[l];
+        return n;
+    }
+
+    /* the first `count` distinct questions draw(rng) gives (count at
+       most the number that exist) */
+    template<class Draw>
+    static std::vector<Record> distinct(std::size_t count, std::uint64_t seed, Draw draw){
+        std::seed_seq seq{(std::uint32_t)seed,(std::uint32_t)(seed>>32),0u};
+        std::mt19937_64 rng(seq);
+        FlatKeySet seen(count+1);
+        std::vector<Record> out;
+        out.reserve(count);
+        for(long long stall=0; out.size()<count && stall<STALL_LIMIT; ){
+            Question q = draw(rng);
+            if(!seen.insert(question_key(q.rec))){ ++stall; continue; }
+            out.push_back({std::move(q.expr), std::move(q.ans), q.difficulty, corpus::level_of(q.difficulty)});
+            stall = 0;
+        }
+        return out;
+    }
+
+    /* over every level: the draws of expo_gen with one thread.  A
+       narrower range samples it directly (section 8b), which gives the
+       same distribution as filtering those draws on the level.        */
+    std::vector<Record> generate(std::size_t count, std::uint64_t seed, int min_level, int max_level){
+        count = std::min(count, capacity(min_level, max_level));
+        if(min_level==1 && max_level==corpus::LEVELS)
+            return distinct(count, seed, [](std::mt19937_64& rng){ return generate_one(rng); });
+        int qlo = 0, qhi = -1;
+        if(count) difficulty_sampler().level_span(min_level, max_level, qlo, qhi);
+        return distinct(count, seed, [&](std::mt19937_64& rng){
+            return make_question(difficulty_sampler().draw(rng, qlo, qhi));
+        });
+    }
+
+    std::vector<Record> generate_in_range(std::size_t count, std::uint64_t seed, double min_diff, double max_diff){
+        int qlo, qhi;
+        if(!band_quarters(min_diff, max_diff, qlo, qhi)) return {};
+        const DifficultySampler& s = difficulty_sampler();
+        count = std::min(count, s.size(qlo, qhi));
+        return distinct(count, seed, [&](std::mt19937_64& rng){ return make_question(s.draw(rng, qlo, qhi)); });
+    }
+
+    std::vector<Record> generate_range(std::uint64_t seed, std::uint64_t first, std::uint64_t last){
+        std::vector<Record> out;
+        if(last<=first) return out;
+        out.reserve(last-first);
+        for(std::uint64_t i=first;i<last;++i){
+            Question q = question_at(seed, i);
+            out.push_back({std::move(q.expr), std::move(q.ans), q.difficulty, corpus::level_of(q.difficulty)});
+        }
+        return out;
+    }
+
+    } // namespace expo
@@ -0,0 +1,224 @@
+/*  expo_core.h  ─────────  rational-exponent question generator library
+    Build with expo_core.cpp (g++ -std=c++20 -O2).
+
+    namespace expo is the stable surface: plain records, no internal
+    types.  expo::detail above it is shared with the expo_gen CLI
+    (compact records, dedup sets, samplers) and may change between
+    versions; the addon uses expo:: only.
+
+      std::vector<expo::Record> v = expo::generate(1000, 42, 3, 5);
+                                                                        */
+    #pragma once
+    #include <algorithm>
+    #include <array>
+    #include <cmath>
+    #include <cstdint>
+    #include <random>
+    #include <string>
+    #include <string_view>
+    #include <vector>
+    #include "corpus_format.h"
+    #include "philox.h"
+
+    namespace expo::detail {
+
+    /* compact question: the choices that produced it, answer, difficulty.
+       14 bytes, no pointers: the runners draw, dedup, bucket and sort
+       these and only render what they write.                          */
+    struct QRec{
+        std::uint8_t form{0};           // Form
+        std::uint8_t base{0};           // all_bases index (DIFFBASE: a)
+        std::uint8_t base2{0};          // DIFFBASE: b
+        std::uint8_t x{0}, y{0}, z{0};  // exp_pool indices (DIFFBASE: m)
+        char op{0};                     // DIFFBASE: * / + -
+        bool bare{false};               // SIMPLE: -b^k written without parens
+        std::int16_t n{0}, d{1};        // answer n/d
+        std::int16_t q{0};              // difficulty in quarter points
+    };
+    /* a question with its text.  expr / ans stay empty while the record
+       alone is carried (unrendered()); render() it when it is written. */
+    struct Question{
+        std::string expr, ans;
+        double difficulty;
+        QRec rec;
+    };
+    inline Question unrendered(const QRec& r){
+        Question q;
+        q.difficulty = r.q*0.25;
+        q.rec = r;
+        return q;
+    }
+    /* rendered text in fixed buffers, no heap */
+    struct QText{
+        static constexpr std::size_t MAX_EXPR = 64, MAX_ANS = 16;
+        char expr_buf[MAX_EXPR], ans_buf[MAX_ANS];
+        std::uint8_t expr_len = 0, ans_len = 0;
+        std::string_view expr() const { return {expr_buf, expr_len}; }
+        std::string_view ans()  const { return {ans_buf, ans_len}; }
+    };
+
+    enum Form{SIMPLE,NESTED,CHAIN,DIFFBASE_SAMEEXP};
+    extern const char* const form_names[4];
+    using LevelCounts = std::array<long long, corpus::LEVELS+1>;   // [1..30]
+
+    /* fill r.n/r.d/r.q for the choices in r; false if any filter rejects */
+    bool evaluate(QRec& r);
+    /* record → expression / answer text */
+    void render(const QRec& r, QText& t);
+    void render(const QRec& r, std::string& expr, std::string& ans);
+    Question make_question(const QRec& r);
+    /* one random question; pickForm: optional non-uniform form choice.
+       Instantiated for std::mt19937_64 and philox::Stream.  draw_*
+       return the record, generate_* / question_at the rendered question */
+    template<class Rng>
+    QRec draw_one(Rng& rng, std::discrete_distribution<int>* pickForm = nullptr);
+    template<class Rng>
+    Question generate_one(Rng& rng, std::discrete_distribution<int>* pickForm = nullptr);
+    /* question #index of the counter-based stream for seed: a pure
+       function of (seed, index), computed without the ones before it.
+       Not deduplicated: two indices can give the same question.        */
+    QRec draw_at(std::uint64_t seed, std::uint64_t index);
+    Question question_at(std::uint64_t seed, std::uint64_t index);
+    /* one random question at a level, or with min ≤ difficulty ≤ max,
+       drawn from the same distribution as filtering generate_one() on
+       the score, in O(1) (alias tables).  Throw std::out_of_range when
+       the band holds no question, std::invalid_argument for a NaN or
+       reversed band.  expo::generate_in_range is the stable form.      */
+    QRec draw_at_level(std::mt19937_64& rng, int level);
+    Question generate_at_level(std::mt19937_64& rng, int level);
+    Question generate_in_range(std::mt19937_64& rng, double min_diff, double max_diff);
+    /* --proposal adaptive: same distribution as draw_one(), every draw
+       accepted.  Instantiated for std::mt19937_64 and philox::Stream.  */
+    template<class Rng>
+    QRec draw_adaptive(Rng& rng);
+    /* chance one generate_one() round of choices makes r (before filters) */
+    double draw_probability(const QRec& r);
+    /* every distinct question, once */
+    std::vector<QRec> enumerate_all();
+    void report_enumeration(const std::vector<QRec>& all);
+    /* distinct questions per level (enumerated once, then cached) */
+    LevelCounts level_capacity();
+    /* --check-kernels: exit status; check_kernels() runs
+       check_band_sampler() too (section 8b against filtering draw_one) */
+    int check_kernels();
+    int check_band_sampler();
+
+    /*───────────────────────────────────────────────────────────────────*/
+    /*  dedup: a question's choices pack into one 64-bit key (see
+        question_key); exact flat set or Bloom filter over those keys    */
+    std::uint64_t question_key(const QRec& r);
+    /* draws in a row that gave no new question before a dedup loop
+       (expo::generate, the expo_gen runners) gives up short           */
+    constexpr long long STALL_LIMIT = 1LL<<24;
+    constexpr std::uint64_t mix64(std::uint64_t k){    // splitmix64 finaliser
+        k ^= k>>30; k *= 0xbf58476d1ce4e5b9ULL;
+        k ^= k>>27; k *= 0x94d049bb133111ebULL;
+        return k ^ (k>>31);
+    }
+
+    class FlatKeySet{
+        std::vector<std::uint64_t> slots_;
+        std::size_t count_ = 0;
+        void grow(){
+            std::vector<std::uint64_t> old(slots_.size()*2);
+            old.swap(slots_);
+            count_ = 0;
+            for(std::uint64_t k: old) if(k) insert(k);
+        }
+    public:
+        explicit FlatKeySet(std::size_t expected = 1024){
+            std::size_t cap = 16;
+            while(cap*3 < expected*4) cap <<= 1;
+            slots_.assign(cap, 0);
+        }
+        /* true if k was not present */
+        bool insert(std::uint64_t k){
+            if((count_+1)*4 > slots_.size()*3) grow();
+            std::size_t mask = slots_.size()-1;
+            for(std::size_t i = mix64(k) & mask; ; i = (i+1) & mask){
+                if(slots_[i]==k) return false;
+                if(!slots_[i]){ slots_[i]=k; ++count_; return true; }
+            }
+        }
+        std::size_t size()  const { return count_; }
+        std::size_t bytes() const { return slots_.size()*sizeof(std::uint64_t); }
+    };
+
+    class BloomFilter{
+        std::vector<std::uint64_t> bits_;
+        std::uint64_t m_ = 64;  int k_ = 1;
+    public:
+        BloomFilter() = default;
+        BloomFilter(std::size_t expected, double fp){
+            double m = std::ceil(-(double)std::max<std::size_t>(expected,1)*std::log(fp)
+                                 / (std::log(2.0)*std::log(2.0)));
+            m_ = std::max<std::uint64_t>(64, (std::uint64_t)m);
+            k_ = std::max(1, (int)std::lround(m/std::max<std::size_t>(expected,1)*std::log(2.0)));
+            bits_.assign((m_+63)/64, 0);
+        }
+        /* true if some probed bit was clear, i.e. k is certainly new */
+        bool insert(std::uint64_t k){
+            std::uint64_t h1 = mix64(k), h2 = mix64(h1) | 1;   // double hashing
+            bool fresh = false;
+            for(int i=0;i<k_;++i){
+                std::uint64_t b = (h1 + i*h2) % m_;
+                std::uint64_t bit = 1ULL << (b&63);
+                if(!(bits_[b>>6] & bit)){ fresh = true; bits_[b>>6] |= bit; }
+            }
+            return fresh;
+        }
+        std::size_t bytes() const { return bits_.size()*sizeof(std::uint64_t); }
+    };
+
+    /* one shard of the dedup space: exact by default, Bloom if fp > 0 */
+    struct Dedup{
+        FlatKeySet exact;
+        BloomFilter bloom;
+        bool approx = false;
+        explicit Dedup(std::size_t expected = 1024, double fp = 0)
+            : exact(fp>0? 16 : expected), approx(fp>0){
+            if(approx) bloom = BloomFilter(expected, fp);
+        }
+        bool insert(std::uint64_t k){ return approx? bloom.insert(k) : exact.insert(k); }
+    };
+
+    } // namespace expo::detail
+
+    /*───────────────────────────────────────────────────────────────────*/
+    /*  stable API                                                       */
+    namespace expo {
+
+    constexpr int API_VERSION = 2;     // 2: generate_in_range
+
+    struct Record{
+        std::string expression, answer;
+        double difficulty;
+        int level;                  // corpus::level_of(difficulty), 1..30
+    };
+
+    /* count distinct questions with min_level ≤ level ≤ max_level, a pure
+       function of the arguments.  Over 1..30 they are the questions, in
+       order, of expo_gen --seed S --threads 1; a narrower range is drawn
+       directly at those levels.  Fewer come back only when the range
+       holds fewer (see capacity).  Throws std::invalid_argument for a
+       bad range.                                                        */
+    std::vector<Record> generate(std::size_t count, std::uint64_t seed,
+                                 int min_level = 1, int max_level = corpus::LEVELS);
+
+    /* count distinct questions with min_diff ≤ difficulty ≤ max_diff,
+       drawn directly from that band with the distribution of filtering
+       generate() over every level on the score; a pure function of the
+       arguments.  Either bound may be infinite.  Fewer come back only
+       when the band holds fewer.  Throws std::invalid_argument for a
+       NaN or reversed band.                                            */
+    std::vector<Record> generate_in_range(std::size_t count, std::uint64_t seed,
+                                          double min_diff, double max_diff);
+
+    /* questions first .. last-1 of the counter-based stream for seed
+       (question_at), in index order, repeats included                  */
+    std::vector<Record> generate_range(std::uint64_t seed, std::uint64_t first, std::uint64_t last);
+
+    /* number of distinct questions in a level range */
+    std::size_t capacity(int min_level = 1, int max_level = corpus::LEVELS);
+
+    } // namespace expo
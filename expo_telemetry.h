@@ -0,0 +1,201 @@
+/*  expo_telemetry.h  ─────────  optional rejection counters and stage timers
+    Off unless built with -DEXPO_TELEMETRY: without it every macro below
+    is empty and nothing here is compiled in.  With it:
+
+      EXPO_COUNT(form, reason)   bump a per-thread counter (telemetry::Reject)
+      EXPO_TICK(t)               declare t = cycle counter (rdtsc on x86)
+      EXPO_TOCK(t, stage)        charge cycles since t to a telemetry::Stage
+      EXPO_TELEMETRY_SESSION()   in main(): a progress line on stderr
+                                 every EXPO_TELEMETRY_INTERVAL seconds
+                                 (default 2) and a summary at scope exit
+
+    Counters live in one block per thread, written only by that thread
+    with relaxed atomics (no read-modify-write, no sharing); readers sum
+    all blocks.  Blocks outlive their threads so the summary sees all.  */
+    #pragma once
+    #include <cstdint>
+
+    namespace telemetry {
+
+    /* why a round of choices produced no question */
+    enum Reject : std::uint8_t {
+        ACCEPTED,           // not a rejection: the question was produced
+        EXP_MINUS_ONE,      // combined exponent exactly -1 (legacy rule)
+        IRRATIONAL,         // rational_ok: no exact root
+        COMPONENT,          // |numerator| or denominator > 256
+        BAND,               // value outside 1/256 .. 256 (incl. overflow)
+        TERM_BAND,          // DIFFBASE trap: a term outside 1/256 .. 256
+        SCORER_UNDEFINED,   // subtraction scorer has no value (length_error)
+        EXP_REDRAW,         // DIFFBASE: non-integer exponent drawn again
+        DUPLICATE,          // dropped by dedup
+        NREJECT
+    };
+    enum Stage : std::uint8_t { SAMPLE, SCORE, RENDER, DEDUP, OUTPUT, NSTAGE };
+
+    } // namespace telemetry
+
+    #ifndef EXPO_TELEMETRY
+
+    #define EXPO_COUNT(form, reason)   ((void)0)
+    #define EXPO_TICK(t)               ((void)0)
+    #define EXPO_TOCK(t, stage)        ((void)0)
+    #define EXPO_TELEMETRY_SESSION()   ((void)0)
+
+    #else
+
+    #include <atomic>
+    #include <chrono>
+    #include <condition_variable>
+    #include <cstdio>
+    #include <mutex>
+    #include <thread>
+    #include <vector>
+    #if defined(__x86_64__) || defined(__i386__)
+    #include <x86intrin.h>
+    #endif
+
+    #ifndef EXPO_TELEMETRY_INTERVAL
+    #define EXPO_TELEMETRY_INTERVAL 2
+    #endif
+
+    namespace telemetry {
+
+    constexpr int NFORM = 4;
+    inline const char* const reject_names[NREJECT] = {
+        "accepted","exp=-1","irrational","component>256","band","term-band",
+        "scorer-undef","exp-redraw","duplicate"};
+    inline const char* const stage_names[NSTAGE] = {"sample","score","render","dedup","output"};
+    inline const char* const form_labels[NFORM] = {"SIMPLE","NESTED","CHAIN","DIFFBASE"};
+
+    inline std::uint64_t ticks(){
+    #if defined(__x86_64__) || defined(__i386__)
+        return __rdtsc();
+    #else
+        return std::chrono::steady_clock::now().time_since_epoch().count();
+    #endif
+    }
+
+    struct Counters{
+        std::atomic<std::uint64_t> reject[NFORM][NREJECT]{};
+        std::atomic<std::uint64_t> cycles[NSTAGE]{}, calls[NSTAGE]{};
+    };
+
+    inline std::mutex registry_m;
+    inline std::vector<Counters*> registry;
+
+    inline Counters& local(){
+        thread_local Counters* c = []{
+            auto* p = new Counters;             // kept after the thread exits
+            std::lock_guard<std::mutex> g(registry_m);
+            registry.push_back(p);
+            return p;
+        }();
+        return *c;
+    }
+    inline void bump(std::atomic<std::uint64_t>& a, std::uint64_t by){
+        a.store(a.load(std::memory_order_relaxed) + by, std::memory_order_relaxed);
+    }
+    inline void count(int form, int why){ bump(local().reject[form][why], 1); }
+    inline void add_stage(Stage s, std::uint64_t cyc){
+        Counters& c = local();
+        bump(c.cycles[s], cyc);
+        bump(c.calls[s], 1);
+    }
+
+    struct Totals{
+        std::uint64_t reject[NFORM][NREJECT]{};
+        std::uint64_t cycles[NSTAGE]{}, calls[NSTAGE]{};
+    };
+    inline Totals totals(){
+        Totals t;
+        std::lock_guard<std::mutex> g(registry_m);
+        for(Counters* c: registry){
+            for(int f=0;f<NFORM;++f) for(int r=0;r<NREJECT;++r)
+                t.reject[f][r] += c->reject[f][r].load(std::memory_order_relaxed);
+            for(int s=0;s<NSTAGE;++s){
+                t.cycles[s] += c->cycles[s].load(std::memory_order_relaxed);
+                t.calls[s]  += c->calls[s].load(std::memory_order_relaxed);
+            }
+        }
+        return t;
+    }
+
+    /* progress thread + exit summary */
+    class Session{
+        using Clock = std::chrono::steady_clock;
+        Clock::time_point t0_ = Clock::now();
+        std::uint64_t tick0_ = ticks();
+        std::mutex m_;
+        std::condition_variable cv_;
+        bool done_ = false;
+        std::thread progress_;
+
+        double secs() const { return std::chrono::duration<double>(Clock::now()-t0_).count(); }
+
+        void line(){
+            Totals t = totals();
+            std::uint64_t acc = 0, rej = 0, dup = 0;
+            for(int f=0;f<NFORM;++f){
+                acc += t.reject[f][ACCEPTED];
+                dup += t.reject[f][DUPLICATE];
+                for(int r=EXP_MINUS_ONE;r<DUPLICATE;++r) if(r!=EXP_REDRAW) rej += t.reject[f][r];
+            }
+            double s = secs();
+            std::fprintf(stderr, "[telemetry] %7.1fs  out %llu (%.0f/s)  drawn %llu  accept %.1f%%  dup %.1f%%\n",
+                         s, (unsigned long long)t.calls[OUTPUT], t.calls[OUTPUT]/s,
+                         (unsigned long long)(acc+rej), acc+rej? 100.0*acc/(acc+rej) : 0.0,
+                         acc? 100.0*dup/acc : 0.0);
+        }
+    public:
+        Session(){
+            progress_ = std::thread([this]{
+                std::unique_lock<std::mutex> g(m_);
+                while(!cv_.wait_for(g, std::chrono::seconds(EXPO_TELEMETRY_INTERVAL), [this]{ return done_; }))
+                    line();
+            });
+        }
+        Session(const Session&) = delete;
+        Session& operator=(const Session&) = delete;
+        ~Session(){
+            { std::lock_guard<std::mutex> g(m_);  done_ = true; }
+            cv_.notify_all();
+            progress_.join();
+            report();
+        }
+
+        void report(){
+            Totals t = totals();
+            double s = secs();
+            double cyclesPerNs = s>0? (ticks()-tick0_)/(s*1e9) : 1;
+            std::fprintf(stderr, "[telemetry] summary after %.2fs\n%-10s", s, "form");
+            for(int r=0;r<NREJECT;++r) std::fprintf(stderr, " %13s", reject_names[r]);
+            std::fprintf(stderr, "\n");
+            for(int f=0;f<NFORM;++f){
+                std::uint64_t drawn = 0;
+                for(int r=0;r<DUPLICATE;++r) if(r!=EXP_REDRAW) drawn += t.reject[f][r];
+                if(!drawn && !t.reject[f][EXP_REDRAW]) continue;
+                std::fprintf(stderr, "%-10s", form_labels[f]);
+                for(int r=0;r<NREJECT;++r) std::fprintf(stderr, " %13llu", (unsigned long long)t.reject[f][r]);
+                std::fprintf(stderr, "   accept %.1f%%\n", drawn? 100.0*t.reject[f][ACCEPTED]/drawn : 0.0);
+            }
+            std::uint64_t all = 0;
+            for(int st=0;st<NSTAGE;++st) all += t.cycles[st];
+            std::fprintf(stderr, "%-10s %13s %15s %12s %9s %7s\n", "stage", "calls", "cycles", "cyc/call", "ns/call", "share");
+            for(int st=0;st<NSTAGE;++st){
+                if(!t.calls[st]) continue;
+                double per = (double)t.cycles[st]/t.calls[st];
+                std::fprintf(stderr, "%-10s %13llu %15llu %12.0f %9.1f %6.1f%%\n", stage_names[st],
+                             (unsigned long long)t.calls[st], (unsigned long long)t.cycles[st],
+                             per, per/cyclesPerNs, all? 100.0*t.cycles[st]/all : 0.0);
+            }
+        }
+    };
+
+    } // namespace telemetry
+
+    #define EXPO_COUNT(form, reason)   ::telemetry::count((form), (reason))
+    #define EXPO_TICK(t)               std::uint64_t t = ::telemetry::ticks()
+    #define EXPO_TOCK(t, stage)        ::telemetry::add_stage((stage), ::telemetry::ticks() - (t))
+    #define EXPO_TELEMETRY_SESSION()   ::telemetry::Session expo_telemetry_session_
+
+    #endif
@@ -1,542 +1,931 @@
 /*  exponent_generator.cpp  ─────────  10 000 rational-exponent questions
-    compile:  g++ -std=c++20 -O2 exponent_generator.cpp -o expo_gen     */
-
+    compile:  g++ -std=c++20 -O2 -pthread exponent_generator.cpp expo_core.cpp arith_core.cpp -o expo_gen
+    usage:    expo_gen [--family F] [--count N] [--seed S] [--threads T] [--dedup-fp P]
+                       [--proposal uniform|adaptive]
+                       [--levels round|equal|C1,C2,... [--warmup N]] [--index FILE]
+                       [--out FILE | --fd N | --binary-out FILE]
+              expo_gen --enumerate [--count N] [--seed S] [output options]
+              expo_gen --range I:J [--seed S] [--threads T] [output options]
+              expo_gen --per-level N | --level-quota L:N,... [--shard-dir DIR]
+              expo_gen --serve unix:PATH|tcp:[HOST:]PORT [--threads T]
+                       [--buffer N] [--wait-ms MS]
+              expo_gen --check-kernels
+    families: exponent (default) or arithmetic (question_family.h); the
+              arithmetic family takes --count, --range and --per-level
+    proposal: how --count and --range draw exponent questions: uniform
+              choices filtered (default), or adaptive, straight from the
+              accepted set with the same distribution (draw_adaptive);
+              output differs per seed, not in distribution
+    levels:   every record carries "level" 1..30: round(difficulty) by
+              default; --levels equal fixes equal-population cuts from
+              the first --warmup questions (default 65536), C1,C2,...
+              gives the cuts.  Any --levels prints a difficulty
+              histogram on stderr at the end (LevelMap)
+    dedup:    exact; --dedup-fp P swaps in Bloom filters with false-
+              positive rate P, which drop some questions for good, so a
+              --count or quota near the capacity can come up short: the
+              run then stops after 2^24 draws in a row gave nothing new
+              and exits 1
+    index:    --index FILE (with --count or --enumerate) skips questions
+              whose key is in FILE and, once the output is closed, adds
+              the keys of those written, creating FILE if needed: rerun
+              with a new seed and the same index to grow a corpus by new
+              questions only.  Until then the keys wait in FILE.new, 8
+              bytes a question on disk (dedup_index.h)
+    telemetry: add -DEXPO_TELEMETRY for rejection counts per form, stage
+               timings and a progress line on stderr (expo_telemetry.h) */
+
+    #include "expo_core.h"
+    #include "question_family.h"
     #include <iostream>
-    #include <iomanip>
     #include <string>
     #include <vector>
     #include <array>
-    #include <unordered_set>
     #include <random>
-    #include <utility>
-    #include <numeric>      // std::gcd
-    #include <cmath>
     #include <cstdint>
-    
-    #if __cplusplus < 201703L
-    // ---------------------------------------------------------------------------
-    // Fallback gcd/lcm for pre-C++17 compilers (put inside std namespace to mimic
-    // the real symbols so existing code remains unchanged).
-    // ---------------------------------------------------------------------------
-    namespace std {
-        template <typename T>
-        constexpr T gcd(T a, T b) {
-            while (b != 0) {
-                T t = a % b;
-                a = b;
-                b = t;
+    #include <cstdlib>
+    #include <cstdio>
+    #include <cstring>
+    #include <thread>
+    #include <barrier>
+    #include <memory>
+    #include <charconv>
+    #include <cerrno>
+    #include <exception>
+    #include <string_view>
+    #include <mutex>
+    #include <condition_variable>
+    #include <atomic>
+    #include <chrono>
+    #include <cmath>
+    #include <algorithm>
+    #include "local_socket.h"
+    #include "expo_telemetry.h"
+    #include "quantile_sketch.h"
+    #include "dedup_index.h"
+
+    using namespace expo::detail;
+
+    /*───────────────────────────────────────────────────────────────────*/
+    /*  6.  sharded parallel generation                                  */
+    /*  Every worker owns one RNG (seeded from seed + worker id) and one
+        shard of the dedup space (question keys that hash to id).  A
+        round is: all workers fill a batch → each shard owner scans the
+        batches in worker order and keeps first occurrences → the writer
+        writes kept questions in worker/batch order, overlapping the
+        next round.  Nothing depends on thread timing, so output is a
+        function of (seed, T) only.                                    */
+    constexpr int BATCH = 4096;
+
+    /* JSONL straight into a file descriptor: one reusable buffer, fields
+       appended in place, difficulty via to_chars (same text as
+       std::fixed << setprecision(2)), flushed with bulk write()s.      */
+    class JsonlWriter{
+        int fd_;
+        bool own_;
+        std::vector<char> buf_;
+        std::size_t len_ = 0;
+    public:
+        static constexpr std::size_t CAPACITY = 1<<20;
+        explicit JsonlWriter(int fd, bool own=false) : fd_(fd), own_(own), buf_(CAPACITY) {}
+        JsonlWriter(const JsonlWriter&) = delete;
+        JsonlWriter& operator=(const JsonlWriter&) = delete;
+        ~JsonlWriter(){ try{ flush(); }catch(...){}  if(own_) ::close(fd_); }
+
+        /* one JSONL line into [p, end), end - p ≥ expr + ans + FIXED;
+           level > 0 adds a "level" field after the difficulty.  Returns
+           the new end of the text.                                     */
+        static constexpr std::size_t FIXED = 64;   // keys, quotes, number, newline
+        static char* format(char* p, char* end, std::string_view expr, std::string_view ans,
+                            double difficulty, int level=0){
+            auto put = [&](std::string_view s){ std::memcpy(p, s.data(), s.size()); p += s.size(); };
+            put("{\"expression\":\"");  put(expr);
+            put("\",\"answer\":\"");    put(ans);
+            put("\",\"difficulty\":");
+            p = std::to_chars(p, end, difficulty, std::chars_format::fixed, 2).ptr;
+            if(level>0){
+                put(",\"level\":");
+                p = std::to_chars(p, end, level).ptr;
             }
-            return a < 0 ? -a : a;   // always non-negative
+            put("}\n");
+            return p;
         }
-        template <typename T>
-        constexpr T lcm(T a, T b) {
-            return (a / gcd(a, b)) * b;
+        void write(std::string_view expr, std::string_view ans, double difficulty, int level=0){
+            if(len_ + expr.size() + ans.size() + FIXED > buf_.size()) flush();
+            char* base = buf_.data();
+            len_ = format(base+len_, base+buf_.size(), expr, ans, difficulty, level) - base;
         }
-    } // namespace std
-    #endif
-    
-    /*───────────────────────────────────────────────────────────────────*/
-    /*  0.  original +-×÷ difficulty helpers (verbatim from your file)  */
-    double addition_diff(long long a,long long b){
-        std::string s1=std::to_string(a),s2=std::to_string(b);
-        double base=0.5*std::min(s1.size(),s2.size());
-        int n=std::max(s1.size(),s2.size());
-        s1.insert(s1.begin(),n-s1.size(),'0');
-        s2.insert(s2.begin(),n-s2.size(),'0');
-        int carry=0,cnt=0;
-        for(int i=n-1;i>=0;--i)
-            if((s1[i]-'0')+(s2[i]-'0')+carry>=10){cnt++;carry=1;}else carry=0;
-        return base+0.75*cnt;
-    }
-    double subtraction_diff(long long a,long long b){
-        if(a>b) std::swap(a,b);
-        std::string small=std::to_string(a),big=std::to_string(b);
-        double base=0.5*small.size();
-        small.insert(small.begin(),big.size()-small.size(),'0');
-        int borrow=0,cnt=0;
-        for(int i=big.size()-1;i>=0;--i){
-            int top=(big[i]-'0')-borrow;
-            if(top<(small[i]-'0')){cnt++;borrow=1;}else borrow=0;
-        }
-        return base+0.75*cnt;
-    }
-    std::pair<long long,double> multiply_one_digit(int d,long long num){
-        std::string s=std::to_string(num);
-        double chunk=0, add=0; long long total=0;
-        for(int i=s.size()-1;i>=0;--i){
-            chunk+=0.5;
-            long long part=1LL*d*(s[i]-'0')*
-                           static_cast<long long>(std::pow(10,s.size()-1-i));
-            if(total){add+=addition_diff(total,part); total+=part;} else total=part;
-        }
-        return {total,chunk+add};
-    }
-    std::vector<std::pair<int,int>> decompose(long long n){
-        std::string s=std::to_string(n);
-        std::vector<std::pair<int,int>> v;
-        for(int i=0;i<s.size();++i) if(s[i]!='0')
-            v.push_back({s[i]-'0',(int)s.size()-1-i});
-        return v;
-    }
-    std::pair<long long,double> mul_diff(long long A,long long B){
-        double subtotal=0,add=0; long long total=0;
-        for(auto [core,z]:decompose(A)){
-            auto [val,d]=multiply_one_digit(core,B);
-            subtotal+=d; val*=static_cast<long long>(std::pow(10,z));
-            if(total){add+=addition_diff(total,val); total+=val;} else total=val;
-        }
-        return {total, subtotal+add};
-    }
-    double div_diff(long long dividend,long long divisor){
-        double diff=0; long long rem=0;
-        for(char ch: std::to_string(dividend)){
-            rem=rem*10+(ch-'0');
-            if(rem<divisor) continue;
-            diff+=subtraction_diff(rem,divisor);
-            rem-=divisor;
-        }
-        return diff;
-    }
-    /*───────────────────────────────────────────────────────────────────*/
-    /*  1.  fraction & utility structs                                   */
-    struct Frac { long long n{0}, d{1}; };           // n / d,  d>0
-    
-    // forward declaration (definition below)
-    std::pair<Frac,double> diff_on_fraction(char op,const Frac& a,const Frac& b);
-    
-    Frac reduce(Frac f){
-        long long g = std::gcd(std::llabs(f.n), f.d);
-        f.n /= g; f.d /= g;
-        if (f.d < 0){ f.d = -f.d; f.n = -f.n; }
-        return f;
-    }
-    double value(const Frac& f){ return static_cast<double>(f.n)/f.d; }
-    
-    long long llpow(long long b,long long e){
-        long long res=1; while(e){ if(e&1) res*=b; b*=b; e>>=1; } return res;
-    }
-    bool is_perfect_kth(long long x,int k){
-        if(x<0) x=-x;
-        long long r=std::llround(std::pow(x,1.0/k));
-        return llpow(r,k)==x||llpow(r+1,k)==x;
-    }
-    /* helper: difficulty of repeating mul base × … × base (k factors)  */
-    double diff_repeat_mul(long long b,int k){
-        if(k<=1) return 0;
-        double d=0;
-        for(int i=1;i<k;++i) d+=mul_diff(std::llabs(b),std::llabs(b)).second;
-        return d;
-    }
-    /* numerator+denominator variant for fractional base                */
-    double diff_repeat_mul_frac(long long p,long long q,int k){
-        return diff_repeat_mul(p,k)+diff_repeat_mul(q,k);
-    }
-    /*───────────────────────────────────────────────────────────────────*/
-    /*  2.  difficulty for b^(n/d)  (atomic, after exponent is final)    */
-    double diff_power(const Frac& base, const Frac& exp){
-        long long n = exp.n;
-        long long d = exp.d;
-
-        // trivial cases retain old behaviour
-        if(n==0 || (n==1 && d==1)) return 0.5;  // a^0 or a^1
-
-        bool frac_exp = (d!=1);
-        bool negative = (n<0);
-        long long absn = std::llabs(n);
-
-        // helper lambdas ---------------------------------------------------
-        auto power_cost = [&](long long num,long long den,long long k)->double{
-            if(k<=1) return 0.0;
-            if(den==1) return diff_repeat_mul(num, (int)k);
-            return diff_repeat_mul_frac(num, den, (int)k);
-        };
+        void flush(){
+            for(std::size_t done=0; done<len_; ){
+                ssize_t n = ::write(fd_, buf_.data()+done, len_-done);
+                if(n<0){
+                    if(errno==EINTR) continue;
+                    throw std::runtime_error(std::string("write failed: ")+std::strerror(errno));
+                }
+                done += n;
+            }
+            len_ = 0;
+        }
+    };
 
-        auto root_cost = [&](long long num,long long den,int root)->double{
-            long long rNum = std::llround(std::pow((double)num, 1.0 / root));
-            long long rDen = std::llround(std::pow((double)den, 1.0 / root));
-            return diff_repeat_mul_frac(rNum, rDen, root);
-        };
+    /* q's text: its own strings, or (an unrendered record) rendered into t */
+    static void text_of(const Question& q, QText& t, std::string_view& expr, std::string_view& ans){
+        if(!q.expr.empty()){ expr = q.expr;  ans = q.ans;  return; }
+        render(q.rec, t);
+        expr = t.expr();  ans = t.ans();
+    }
 
-        //------------------------------------------------------------------
-        // Order A : power first, then root
-        double costA = 0.0;
-        // power step on original base
-        costA += power_cost(std::llabs(base.n), base.d, absn);
-
-        if(frac_exp){
-            // intermediate base after power
-            long long intNum, intDen;
-            if(base.d==1){
-                intNum = std::llabs(llpow(base.n,absn));
-                intDen = 1;
-            }else{
-                intNum = llpow(base.n,absn);
-                intDen = llpow(base.d,absn);
+    /*  The level written on every --count / --range / --enumerate record
+        (--levels).  round: corpus::level_of, the fixed rule.  C1,...,Cm:
+        ascending cut points, level L holding (C[L-1], C[L]].  equal: the
+        distinct difficulties of the first --warmup questions (from a KLL
+        sketch) are split into 30 runs of as equal population as the
+        ties allow, so the levels start out equally full; with fewer
+        than 30 distinct values each gets a level of its own and the
+        rest stay empty, with a warning.  Those questions are held back
+        until the cuts are fixed; the rest are written as they come, so a
+        run of any length is a single pass.  Cuts compare the difficulty
+        as written (2 decimals), so records that show the same difficulty
+        share a level.  With --levels the sketch keeps running and
+        close() reports the histogram.                                   */
+    class LevelMap{
+        enum Mode{ ROUND, EQUAL, CUTS } mode_ = ROUND;
+        std::vector<double> cuts_;
+        bool fixed_ = true;
+        kll::Sketch sketch_;
+        LevelCounts count_{};
+        std::array<double, corpus::LEVELS+1> lo_, hi_;
+    public:
+        std::size_t warmup = 1<<16;
+        bool report = false;
+
+        LevelMap(){ lo_.fill(INFINITY);  hi_.fill(-INFINITY); }
+        /* "round", "equal" or "C1,C2,..." (at most 29, ascending) */
+        bool parse(const char* spec){
+            report = true;
+            if(!std::strcmp(spec,"round")){ mode_ = ROUND;  return true; }
+            if(!std::strcmp(spec,"equal")){ mode_ = EQUAL;  fixed_ = false;  return true; }
+            mode_ = CUTS;
+            for(const char* p = spec; ; ++p){
+                char* end;
+                double c = std::strtod(p, &end);
+                if(end==p || (!cuts_.empty() && c<=cuts_.back())) return false;
+                cuts_.push_back(c);
+                if(!*end) break;
+                if(*end!=',') return false;
+                p = end;
+            }
+            return cuts_.size()<corpus::LEVELS;
+        }
+        bool calibrating() const { return !fixed_; }
+        void observe(double d){ if(report) sketch_.update(d); }
+        /* equal: cuts from what the sketch has seen so far.  The sorted
+           distinct values are split into 30 non-empty runs minimising
+           the sum of squared run weights, i.e. as even as the ties allow
+           (dynamic programming, O(30·n²) over the sketch's n values).   */
+        void fix(){
+            fixed_ = true;
+            if(!sketch_.count()) return;
+            std::vector<double> value;
+            std::vector<double> upto{0};                    // upto[i]: weight of value[0..i)
+            for(auto [v, w]: sketch_.sorted()){
+                v = printed(v);
+                if(value.empty() || v!=value.back()){ value.push_back(v);  upto.push_back(upto.back()); }
+                upto.back() += (double)w;
+            }
+            const int n = (int)value.size(), L = corpus::LEVELS;
+            cuts_.clear();
+            if(n<L){
+                cuts_.assign(value.begin(), value.end()-1);
+                std::cerr<<"levels equal: only "<<n<<" distinct difficulties in the warm-up, so "
+                         <<n<<" of "<<L<<" levels are populated\n";
+                return;
+            }
+            /* cost[j]: best split of value[0..j) into l runs; from[l][j]: where its last run starts */
+            std::vector<double> cost(n+1, INFINITY), next(n+1);
+            std::vector<std::vector<int>> from(L+1, std::vector<int>(n+1, 0));
+            cost[0] = 0;
+            for(int l=1;l<=L;++l){
+                std::fill(next.begin(), next.end(), INFINITY);
+                for(int j=l;j<=n-(L-l);++j)
+                    for(int i=l-1;i<j;++i){
+                        double w = upto[j]-upto[i], c = cost[i] + w*w;
+                        if(c<next[j]){ next[j] = c;  from[l][j] = i; }
+                    }
+                cost.swap(next);
+            }
+            cuts_.resize(L-1);
+            for(int l=L, j=n; l>1; --l){
+                j = from[l][j];
+                cuts_[l-2] = value[j-1];
             }
-            costA += root_cost(intNum, intDen, (int)d);
         }
+        /* d as JsonlWriter writes it */
+        static double printed(double d){
+            char buf[32];
+            auto r = std::to_chars(buf, buf+sizeof buf, d, std::chars_format::fixed, 2);
+            std::from_chars(buf, r.ptr, d);
+            return d;
+        }
+        int level(double d){
+            if(mode_!=ROUND) d = printed(d);
+            int l = mode_==ROUND? corpus::level_of(d)
+                  : 1 + int(std::lower_bound(cuts_.begin(), cuts_.end(), d) - cuts_.begin());
+            ++count_[l];
+            lo_[l] = std::min(lo_[l], d);  hi_[l] = std::max(hi_[l], d);
+            return l;
+        }
+        void print(std::ostream& os) const {
+            long long total = 0, most = 1;
+            int populated = 0;
+            for(int l=1;l<=corpus::LEVELS;++l){
+                total += count_[l];  most = std::max(most, count_[l]);  populated += count_[l]>0;
+            }
+            char line[128];
+            os<<"levels: "<<(mode_==ROUND? "round" : mode_==EQUAL? "equal" : "cuts");
+            if(mode_==EQUAL) os<<", cuts from the first "<<std::min<std::uint64_t>(warmup, sketch_.count())<<" questions";
+            if(populated<corpus::LEVELS) os<<", "<<populated<<" of "<<corpus::LEVELS<<" levels populated";
+            os<<"\nlevel  difficulty           count   share\n";
+            for(int l=1;l<=corpus::LEVELS;++l){
+                if(!count_[l]) continue;
+                std::snprintf(line, sizeof line, "%5d  %7.2f..%-7.2f %9lld  %5.1f%%  ", l, lo_[l], hi_[l],
+                              count_[l], 100.0*count_[l]/total);
+                os<<line<<std::string((std::size_t)(40*count_[l]/most), '#')<<"\n";
+            }
+            if(!sketch_.count()) return;
+            std::vector<double> q = sketch_.quantiles({0.01, 0.1, 0.25, 0.5, 0.75, 0.9, 0.99});
+            std::snprintf(line, sizeof line, "difficulty: n %llu  min %.2f  p1 %.2f  p10 %.2f  p25 %.2f  p50 %.2f",
+                          (unsigned long long)sketch_.count(), sketch_.min(), q[0], q[1], q[2], q[3]);
+            os<<line;
+            std::snprintf(line, sizeof line, "  p75 %.2f  p90 %.2f  p99 %.2f  max %.2f\n", q[4], q[5], q[6], sketch_.max());
+            os<<line;
+        }
+    };
 
-        // Order B : root first, then power
-        double costB = 0.0;
-        if(frac_exp){
-            // cost of taking root of original base
-            costB += root_cost(std::llabs(base.n), base.d, (int)d);
+    /* where accepted questions go: JSONL to a descriptor, or a packed corpus */
+    struct Sink{
+        std::unique_ptr<JsonlWriter> jsonl;
+        std::unique_ptr<corpus::Writer> binary;
+        LevelMap levels;
+        QText text;
+        std::vector<Question> held;               // --levels equal warm-up
+        void emit(const Question& q){
+            levels.observe(q.difficulty);
+            if(!levels.calibrating()){ write(q);  return; }
+            held.push_back(q);
+            if(held.size()>=levels.warmup) release();
+        }
+        /* OUTPUT starts after text_of(): render() charges RENDER itself */
+        void write(const Question& q){
+            std::string_view expr, ans;
+            text_of(q, text, expr, ans);
+            EXPO_TICK(t0);
+            int level = levels.level(q.difficulty);
+            if(binary) binary->add(expr, ans, q.difficulty, level);
+            else       jsonl->write(expr, ans, q.difficulty, level);
+            EXPO_TOCK(t0, telemetry::OUTPUT);
+        }
+        void release(){
+            levels.fix();
+            for(const Question& q: held) write(q);
+            std::vector<Question>().swap(held);
+        }
+        void close(){
+            if(levels.calibrating()) release();
+            if(binary) binary->close();
+            if(jsonl)  jsonl->flush();
+            if(levels.report) levels.print(std::cerr);
+        }
+    };
 
-            // base after root
-            long long rNum = std::llround(std::pow((double)std::llabs(base.n), 1.0 / d));
-            long long rDen = std::llround(std::pow((double)base.d, 1.0 / d));
+    struct Worker{
+        std::mt19937_64 rng;
+        /* two rounds in flight: round r lives in slot r&1 */
+        std::array<std::vector<Question>, 2> batch;
+        std::array<std::vector<char>, 2> keep;
+        std::array<std::vector<std::vector<int>>, 2> by_shard;  // batch indices per shard
+        long long kept = 0;                       // this shard's keeps, current round
+        Dedup seen;                               // shard owned by this worker
+    };
 
-            costB += power_cost(rNum, rDen, absn);
-        }else{
-            // no root step, same as power first
-            costB = costA;
+    int shard_of(std::uint64_t key, int threads){     // high bits: slots use the low ones
+        return (int)(((mix64(key)>>32) * (std::uint64_t)threads) >> 32);
+    }
+
+    /* index: questions already in the corpus (--index), skipped like
+       repeats; the keys of what is emitted are staged in it, for main
+       to commit once the output is closed.  Returns the number written:
+       short of target only if STALL_LIMIT draws in a row gave nothing
+       new (a Bloom filter, --dedup-fp, drops some questions for good,
+       so it can stall below the capacity).
+
+       The calling thread is the writer and runs one round behind the
+       T workers: while it writes round r, they generate and dedup
+       round r+1 into the other slot.  Whether round r ends the run
+       needs only its keep counts, so the workers decide it at the
+       dedup barrier without waiting for the writer; they wait for it
+       only before reusing a slot.                                      */
+    long long run_sharded(Sink& sink, const QuestionFamily& fam, long long target, std::uint64_t seed,
+                     int threads, double fp, KeyIndex* index = nullptr){
+        std::vector<Worker> workers(threads);
+        for(int w=0;w<threads;++w){
+            std::seed_seq seq{(std::uint32_t)seed,(std::uint32_t)(seed>>32),
+                              (std::uint32_t)w};
+            workers[w].rng.seed(seq);
+            for(int s=0;s<2;++s){
+                workers[w].batch[s].resize(BATCH);
+                workers[w].keep[s].resize(BATCH);
+                workers[w].by_shard[s].resize(threads);
+            }
+            workers[w].seen = Dedup(target/threads+1, fp);
         }
 
-        double diff = std::min(costA, costB);
+        std::mutex m;
+        std::condition_variable cv;
+        long long deduped = 0, written = 0;    // rounds ready for / done by the writer
+        bool done = false, failed = false;      // last round deduped / the writer threw
+        long long avail = 0, stall = 0;         // keeps so far, draws since the last one
+        std::exception_ptr error;               // the writer's, rethrown once all have joined
+
+        std::barrier generated(threads);
+        auto round_end = [&]() noexcept {
+            long long kept = 0;
+            for(Worker& w: workers){ kept += w.kept;  w.kept = 0; }
+            avail += kept;
+            stall = kept? 0 : stall + (long long)threads*BATCH;
+            std::lock_guard<std::mutex> g(m);
+            ++deduped;
+            done = (avail>=target || stall>=STALL_LIMIT || failed);
+            cv.notify_all();
+        };
+        std::barrier filtered(threads, round_end);
+
+        auto body = [&](int id){
+            Worker& me = workers[id];
+            for(long long r=0;;++r){
+                const int s = r&1;
+                {   /* slot s last held round r-2: the writer must be past it */
+                    std::unique_lock<std::mutex> g(m);
+                    cv.wait(g, [&]{ return written>=r-1 || failed; });
+                }
+                /* generate */
+                for(auto& v: me.by_shard[s]) v.clear();
+                for(int i=0;i<BATCH;++i){
+                    me.batch[s][i] = fam.draw(me.rng);
+                    me.by_shard[s][shard_of(fam.key(me.batch[s][i]), threads)].push_back(i);
+                }
+                generated.arrive_and_wait();
+
+                /* dedup: this worker's shard across all batches */
+                for(Worker& w: workers)
+                    for(int i: w.by_shard[s][id]){
+                        EXPO_TICK(t0);
+                        std::uint64_t k = fam.key(w.batch[s][i]);
+                        w.keep[s][i] = !(index && index->contains(k)) && me.seen.insert(k);
+                        EXPO_TOCK(t0, telemetry::DEDUP);
+                        if(w.keep[s][i]) ++me.kept;
+                        else EXPO_COUNT(w.batch[s][i].rec.form, telemetry::DUPLICATE);
+                    }
+                filtered.arrive_and_wait();
+                if(done) return;            // set by round_end, before the barrier opened
+            }
+        };
 
-        if(frac_exp) diff += 1;   // single non-integer exponent bump
-        if(negative) diff += 1;   // negative exponent bump
+        std::vector<std::thread> pool;
+        for(int w=0;w<threads;++w) pool.emplace_back(body, w);
 
-        return diff;
-    }
-    /*───────────────────────────────────────────────────────────────────*/
-    /*  3.  exponent-arithmetic difficulty (nested & chain)              */
-    double diff_exponent_arith_mul(const Frac& x,const Frac& y){
-        return diff_on_fraction('*', x, y).second;
+        /* output, one round behind */
+        long long produced = 0;
+        for(long long r=0;;++r){
+            {
+                std::unique_lock<std::mutex> g(m);
+                cv.wait(g, [&]{ return deduped>r || done; });
+                if(deduped<=r) break;
+            }
+            const int s = r&1;
+            try{
+                for(Worker& w: workers)
+                    for(int i=0;i<BATCH && produced<target;++i){
+                        if(!w.keep[s][i]) continue;
+                        sink.emit(w.batch[s][i]);
+                        if(index) index->stage(fam.key(w.batch[s][i]));
+                        ++produced;
+                    }
+            }catch(...){
+                error = std::current_exception();
+                std::lock_guard<std::mutex> g(m);
+                failed = true;
+                cv.notify_all();
+                break;
+            }
+            std::lock_guard<std::mutex> g(m);
+            written = r+1;
+            cv.notify_all();
+        }
+        for(auto& t: pool) t.join();
+        if(error) std::rethrow_exception(error);
+        return produced;
     }
+    /* questions [first, last) of the counter-based stream: question i is
+       fam.at(seed, i), so any slice of a run can be regenerated (or
+       split across processes) on its own.  No dedup, since that would
+       tie i to everything before it.  Worker w computes the w-th BATCH
+       of each round; worker 0 writes the round in index order.        */
+    void run_range(Sink& sink, const QuestionFamily& fam, std::uint64_t first, std::uint64_t last,
+                   std::uint64_t seed, int threads){
+        std::vector<Question> round((std::size_t)threads*BATCH);
+        std::uint64_t base = first;
+        bool done = (first>=last);
+        std::exception_ptr failed;
+        std::barrier sync(threads);
+
+        auto body = [&](int id){
+            while(!done){
+                std::uint64_t lo = base + (std::uint64_t)id*BATCH;
+                for(std::uint64_t i=lo; i<last && i<lo+BATCH; ++i)
+                    round[i-base] = fam.at(seed, i);
+                sync.arrive_and_wait();
+
+                if(id==0) try{
+                    std::uint64_t end = std::min<std::uint64_t>(last, base+round.size());
+                    for(std::uint64_t i=base;i<end;++i) sink.emit(round[i-base]);
+                    base = end;
+                    done = (base>=last);
+                }catch(...){
+                    failed = std::current_exception();
+                    done = true;
+                }
+                sync.arrive_and_wait();
+            }
+        };
 
-    double diff_exponent_arith_add(const std::vector<Frac>& list){
-        if(list.empty()) return 0.0;
-        Frac acc = list[0];
-        double diff=0.0;
-        for(size_t i=1;i<list.size();++i){
-            char op = (list[i].n>=0)? '+' : '-';
-            Frac term = list[i];
-            if(op=='-') term.n = -term.n; // make positive for subtraction
-            auto res = diff_on_fraction(op, acc, term);
-            acc = res.first;
-            diff += res.second;
-        }
-        return diff;
+        std::vector<std::thread> pool;
+        for(int w=1;w<threads;++w) pool.emplace_back(body, w);
+        body(0);
+        for(auto& t: pool) t.join();
+        if(failed) std::rethrow_exception(failed);
+    }
+    /* seeded permutation (without replacement) of the whole set, less
+       what the index already has; keys of what is emitted are staged in
+       it, as in run_sharded                                            */
+    void run_enumerated(Sink& sink, long long target, std::uint64_t seed, KeyIndex* index = nullptr){
+        std::vector<QRec> all = enumerate_all();
+        report_enumeration(all);
+        std::seed_seq seq{(std::uint32_t)seed,(std::uint32_t)(seed>>32)};
+        std::mt19937_64 rng(seq);
+        for(std::size_t i=0; i<all.size() && target>0; ++i){
+            std::uniform_int_distribution<std::size_t> pick(i, all.size()-1);
+            std::swap(all[i], all[pick(rng)]);
+            std::uint64_t k = question_key(all[i]);
+            if(index && index->contains(k)) continue;
+            sink.emit(unrendered(all[i]));
+            if(index) index->stage(k);
+            --target;
+        }
     }
     /*───────────────────────────────────────────────────────────────────*/
-    /*  4.  Pools for RNG                                                */
-    const std::vector<Frac> base_pool = {
-        {2,1},{3,1},{4,1},{5,1},{6,1},{7,1},{8,1},{9,1},{10,1},
-        {12,1},{16,1},{25,1},{27,1},{32,1},{36,1},{49,1},
-        {1,2},{1,3},{1,4},{1,5},{2,3},{3,4},{3,5},{4,5}
-    };
-    const std::vector<long long> neg_int_base = {-2,-3,-4,-5,-6,-7,-8,-9,-10};
-    
-    const std::vector<Frac> exp_pool = {
-        {1,1},{2,1},{3,1},{4,1},{5,1},
-        {-1,1},{-2,1},{-3,1},{-4,1},{-5,1},
-        {1,2},{2,3},{3,2},{4,3},{5,2},
-        {-1,2},{-2,3},{-3,2},{-4,3},{-5,2}
-    };
-    /*───────────────────────────────────────────────────────────────────*/
-    struct Question{
-        std::string expr, ans;
-        double difficulty;
-    };
-    
-    /* rational-result filter for base & exponent --------------------- */
-    bool rational_ok(const Frac& b,const Frac& e){
-        long long n=e.n,d=e.d;
-        if(b.d==1){
-            long long absb = std::llabs(b.n);
-            if(d!=1 && !is_perfect_kth(absb,(int)d)) return false;
-            if(b.n<0 && d%2==0) return false;
-        }else{
-            long long p=b.n,q=b.d;
-            if(!is_perfect_kth(p,(int)d) || !is_perfect_kth(q,(int)d)) return false;
+    /*  9.  stratified generation: a quota per level, one shard per level */
+    /*  Levels come from corpus::level_of.  For a family with a level
+        sampler (exponent) quotas are first clamped to what each level
+        can hold, then each level is filled straight from the sampler,
+        dropping repeats.  Other families walk their counter stream from
+        index 0 and keep what lands in a level that still needs it; the
+        arithmetic family with --seed 0 walks question_generator.py's own
+        seeds in its order, and like the script skips levels 0 and 31+.
+        Returns false, after reporting it, when a level stalled short of
+        its (clamped) quota; main then exits 1. */
+    /* "N" (every level) or "L:N,L:N,..." */
+    bool parse_quota(const char* spec, LevelCounts& quota){
+        quota.fill(0);
+        if(!std::strchr(spec,':')){
+            long long n = std::atoll(spec);
+            for(int l=1;l<=corpus::LEVELS;++l) quota[l] = n;
+            return n>=0;
+        }
+        for(const char* p=spec; *p; ){
+            char* end;
+            long l = std::strtol(p,&end,10);
+            if(*end!=':' || l<1 || l>corpus::LEVELS) return false;
+            quota[l] = std::strtoll(end+1,&end,10);
+            if(quota[l]<0 || (*end && *end!=',')) return false;
+            p = *end? end+1 : end;
         }
         return true;
     }
-    /* format fraction to "a/b" (always reduced) --------------------- */
-    std::string frac_to_string(const Frac& f){
-        return std::to_string(f.n) + "/" + std::to_string(f.d);
-    }
-    /* render base: wrap negative integers in parentheses */
-    std::string base_to_string(const Frac& b){
-        if(b.d==1){
-            if(b.n<0) return "("+std::to_string(b.n)+")";
-            return std::to_string(b.n);
+
+    bool run_stratified(const std::string& dir, const QuestionFamily& fam, LevelCounts quota,
+                        std::uint64_t seed, double fp){
+        LevelCounts cap = fam.capacity(), remaining{};
+        long long left = 0;
+        for(int l=1;l<=corpus::LEVELS;++l){
+            if(fam.samples_levels() && quota[l]>cap[l]){
+                std::cerr<<"level "<<l<<": quota "<<quota[l]<<" lowered to the "
+                         <<cap[l]<<" distinct questions it has\n";
+                quota[l] = cap[l];
+            }
+            remaining[l] = quota[l];
+            left += quota[l];
         }
-        return "("+frac_to_string(b)+")";
-    }
-    /* helper pow on rationals (exact via integers) ------------------ */
-    Frac pow_frac(const Frac& b,const Frac& e){    // assume rational_ok
-        long long n=e.n,d=e.d;
-        bool neg = (n<0); long long absn = std::llabs(n);
-        // power
-        long long p = llpow(b.n,absn);
-        long long q = llpow(b.d,absn);
-        // root if needed
-        if(d!=1){
-            long long rootP = std::llround(std::pow(static_cast<double>(p), 1.0 / d));
-            long long rootQ = std::llround(std::pow(static_cast<double>(q), 1.0 / d));
-            p = rootP;
-            q = rootQ;
-        }
-        if(neg) std::swap(p,q);
-        return reduce({p,q});
+
+        if(::mkdir(dir.c_str(), 0755)!=0 && errno!=EEXIST)
+            throw std::runtime_error("cannot create " + dir);
+        std::array<std::unique_ptr<JsonlWriter>, corpus::LEVELS+1> shard;
+        for(int l=1;l<=corpus::LEVELS;++l){
+            if(!quota[l]) continue;
+            char name[32];
+            std::snprintf(name, sizeof name, "/level_%02d.jsonl", l);
+            int fd = ::open((dir+name).c_str(), O_WRONLY|O_CREAT|O_TRUNC, 0644);
+            if(fd<0) throw std::runtime_error("cannot open " + dir + name);
+            shard[l] = std::make_unique<JsonlWriter>(fd, true);
+        }
+
+        std::seed_seq seq{(std::uint32_t)seed,(std::uint32_t)(seed>>32)};
+        std::mt19937_64 rng(seq);
+        Dedup seen(left+1, fp);
+        QText text;
+        auto keep = [&](const Question& q, int l){
+            EXPO_TICK(tDedup);
+            bool fresh = seen.insert(fam.key(q));
+            EXPO_TOCK(tDedup, telemetry::DEDUP);
+            if(!fresh){ EXPO_COUNT(q.rec.form, telemetry::DUPLICATE);  return false; }
+            std::string_view expr, ans;
+            text_of(q, text, expr, ans);                // RENDER, not OUTPUT
+            EXPO_TICK(tOut);
+            shard[l]->write(expr, ans, q.difficulty, l);
+            EXPO_TOCK(tOut, telemetry::OUTPUT);
+            --remaining[l];  --left;
+            return true;
+        };
+        if(fam.samples_levels()){
+            for(int l=1;l<=corpus::LEVELS;++l)
+                for(long long stall=0; remaining[l]>0 && stall<STALL_LIMIT; )
+                    stall = keep(fam.at_level(rng, l), l)? 0 : stall+1;
+        }else{
+            for(std::uint64_t i=0, stall=0; left>0 && stall<STALL_LIMIT; ++i){
+                Question q = fam.at(seed, i);
+                double l = std::nearbyint(q.difficulty);
+                bool wanted = l>=1 && l<=corpus::LEVELS && remaining[(int)l]>0;
+                stall = (wanted && keep(q, (int)l))? 0 : stall+1;
+            }
+        }
+
+        for(int l=1;l<=corpus::LEVELS;++l){
+            if(!quota[l]) continue;
+            shard[l]->flush();
+            std::cerr<<"level "<<l<<": "<<quota[l]-remaining[l]<<"/"<<quota[l]<<"\n";
+        }
+        if(left) std::cerr<<left<<" questions short: "<<STALL_LIMIT
+                          <<" draws in a row gave no new question\n";
+        return left==0;
     }
     /*───────────────────────────────────────────────────────────────────*/
-    /*  5.  generator for ONE question (may be SIMPLE / NESTED / CHAIN) */
-    std::mt19937_64 rng(std::random_device{}());
-    
-    enum Form{SIMPLE,NESTED,CHAIN,DIFFBASE_SAMEEXP};
-    std::uniform_int_distribution<int> distForm(0,3);
-    
-    Question generate_one(){
-        std::uniform_int_distribution<int> bPos(0, base_pool.size()-1);
-        std::uniform_int_distribution<int> bNeg(0, neg_int_base.size()-1);
-        std::uniform_int_distribution<int> ePos(0, exp_pool.size()-1);
-        std::uniform_real_distribution<double> coin(0,1);
-        while(true){
-            /* pick form */
-            Form form = static_cast<Form>(distForm(rng));
-    
-            /* pick base */
-            Frac base;
-            if(coin(rng)<0.3){ base={neg_int_base[bNeg(rng)],1}; }
-            else              base=base_pool[bPos(rng)];
-    
-            /* prepare combined exponent E and difficulty on exponent-arith */
-            Frac E{0,1};  double diff_exp_arith=0;
-            std::string expr;
-            bool extraMinus=false;   // for -b^k without parens
-            Frac val; // will hold final value for magnitude checks
-    
-            if(form==SIMPLE){
-                Frac e = exp_pool[ePos(rng)];
-                E = e;
-                // decide parentheses rule
-                bool needParens=true;
-                if(base.n<0 && base.d==1){
-                    if(e.d==1){ // integer exponent
-                        double prob = (std::llabs(e.n)%2==0? 0.40 : 0.20);
-                        if(rng() / double(rng.max()) < prob) needParens=false;
-                    }else if(e.d%2==0){ // even denominator fraction
-                        needParens=false;
-                    }
-                }
+    /*  10. question server                                              */
+    /*  --serve ENDPOINT keeps one ring of rendered JSONL lines per level
+        and answers requests from them; --threads background generators
+        keep the rings topped up, emptiest first, drawing each level
+        directly (draw_at_level).  Rings are streams, not sets: a
+        level with few distinct questions repeats them.
+
+        protocol, one request per line:
+          GET <level> <n>   →  "OK <k>\n" then k JSONL lines.  k < n only
+                               if the level stayed short for --wait-ms.
+          STATS             →  "OK served=… generated=… fill=f1,…,f30\n"
+          anything else     →  "ERR <reason>\n"                          */
+    class LevelRing{
+        std::vector<std::string> slot_;
+        std::size_t head_ = 0;
+        std::atomic<std::size_t> size_{0};
+    public:
+        std::mutex m;
+        std::condition_variable filled;
+
+        void reserve(std::size_t cap){ slot_.resize(cap); }
+        std::size_t capacity() const { return slot_.size(); }
+        std::size_t size() const { return size_.load(std::memory_order_relaxed); }  // lock-free peek
+        /* caller holds m; copies into the slot's existing buffer */
+        bool push(std::string_view line){
+            std::size_t n = size_.load(std::memory_order_relaxed);
+            if(n==slot_.size()) return false;
+            slot_[(head_+n) % slot_.size()].assign(line);
+            size_.store(n+1, std::memory_order_relaxed);
+            return true;
+        }
+        std::size_t pop(std::size_t want, std::string& out){
+            std::size_t n = size_.load(std::memory_order_relaxed), k = std::min(want, n);
+            for(std::size_t i=0;i<k;++i){
+                out += slot_[head_];
+                head_ = (head_+1) % slot_.size();
+            }
+            size_.store(n-k, std::memory_order_relaxed);
+            return k;
+        }
+    };
 
-                std::string baseStr = needParens ? base_to_string(base)
-                                                  : std::to_string(base.n);
-                if(!needParens && base.n<0 && base.d==1) extraMinus=true;
+    class QuestionServer{
+        std::array<LevelRing, corpus::LEVELS+1> ring_;
+        std::chrono::milliseconds wait_;
+        std::mutex wake_m_;
+        std::condition_variable wake_;                // a consumer took questions
+        std::atomic<long long> served_{0}, generated_{0};
+        std::atomic<bool> stop_{false};
+        std::vector<std::thread> refill_;
+
+        std::array<double, corpus::LEVELS+1> need() const {
+            std::array<double, corpus::LEVELS+1> n{};
+            for(int l=1;l<=corpus::LEVELS;++l)
+                if(ring_[l].capacity())
+                    n[l] = 1.0 - (double)ring_[l].size()/ring_[l].capacity();
+            return n;
+        }
 
-                expr = baseStr + "^" + (e.d==1? std::to_string(e.n)
-                                                 : frac_to_string(e));
-            }
-            else if(form==NESTED){
-                Frac x = exp_pool[ePos(rng)];
-                Frac y = exp_pool[ePos(rng)];
-                /* combine: x·y */
-                E = reduce({ x.n*y.n , x.d*y.d });
-                diff_exp_arith = diff_exponent_arith_mul(x,y);
-                expr = "((" + base_to_string(base)
-                     + ")^" + (x.d==1? std::to_string(x.n)
-                                      : frac_to_string(x))
-                     + ")^"  + (y.d==1? std::to_string(y.n)
-                                      : frac_to_string(y));
+        void refill(std::uint64_t seed, int id){
+            constexpr int CHUNK = 64;                 // questions per visit to a ring
+            std::seed_seq seq{(std::uint32_t)seed,(std::uint32_t)(seed>>32),(std::uint32_t)id};
+            std::mt19937_64 rng(seq);
+            QText text;
+            char line[QText::MAX_EXPR + QText::MAX_ANS + JsonlWriter::FIXED];
+
+            while(true){
+                /* the emptiest ring next; sleep while all are full */
+                int level = 0;
+                {
+                    std::unique_lock<std::mutex> g(wake_m_);
+                    wake_.wait(g, [&]{
+                        if(stop_.load(std::memory_order_relaxed)) return true;
+                        auto n = need();
+                        level = 0;
+                        for(int l=1;l<=corpus::LEVELS;++l)
+                            if(n[l]>0 && (!level || n[l]>n[level])) level = l;
+                        return level!=0;
+                    });
+                    if(stop_.load(std::memory_order_relaxed)) return;
+                }
+                LevelRing& r = ring_[level];
+                for(int i=0; i<CHUNK && r.size()<r.capacity(); ++i){
+                    QRec q = draw_at_level(rng, level);
+                    generated_.fetch_add(1, std::memory_order_relaxed);
+                    render(q, text);
+                    char* end = JsonlWriter::format(line, line + sizeof line, text.expr(), text.ans(),
+                                                    q.q*0.25, level);
+                    std::lock_guard<std::mutex> g(r.m);
+                    if(!r.push(std::string_view(line, end - line))) break;
+                }
+                r.filled.notify_all();
             }
-            else if(form==CHAIN){   /* CHAIN: 3 terms  a^x * a^y / a^z */
-                Frac x = exp_pool[ePos(rng)];
-                Frac y = exp_pool[ePos(rng)];
-                Frac z = exp_pool[ePos(rng)];
-
-                /* combined exponent  E = x + y - z  */
-                long long lcd = std::lcm(x.d, std::lcm(y.d, z.d));
-                long long num =  x.n * (lcd / x.d)
-                              + y.n * (lcd / y.d)
-                              - z.n * (lcd / z.d);
-                E = reduce({num, lcd});
-
-                diff_exp_arith = diff_exponent_arith_add({x, y, {-z.n, z.d}});
-
-                auto baseStr = base_to_string(base);
-                auto expStr = [](const Frac& f){
-                    return (f.d==1? std::to_string(f.n):frac_to_string(f));
-                };
-
-                expr = baseStr + "^(" + expStr(x) + ") * "
-                     + baseStr + "^(" + expStr(y) + ") / "
-                     + baseStr + "^(" + expStr(z) + ")";
+        }
+
+        void handle(const std::string& req, std::string& out){
+            int level = 0, n = 0;
+            char extra;
+            if(std::sscanf(req.c_str(), "GET %d %d %c", &level, &n, &extra)==2){
+                if(level<1 || level>corpus::LEVELS){ out = "ERR level outside 1..30\n"; return; }
+                LevelRing& r = ring_[level];
+                if(!r.capacity()){ out = "ERR no questions at level " + std::to_string(level) + "\n"; return; }
+                if(n<1 || (std::size_t)n>r.capacity()){
+                    out = "ERR n must be in 1.." + std::to_string(r.capacity()) + "\n"; return;
+                }
+                std::string body;
+                std::size_t k;
+                {
+                    std::unique_lock<std::mutex> g(r.m);
+                    r.filled.wait_for(g, wait_, [&]{ return r.size()>=(std::size_t)n; });
+                    k = r.pop(n, body);
+                }
+                { std::lock_guard<std::mutex> g(wake_m_); }  // refillers check need() under it
+                wake_.notify_all();
+                served_.fetch_add(k, std::memory_order_relaxed);
+                out = "OK " + std::to_string(k) + "\n" + body;
+                return;
             }
-            else{   /* DIFFBASE_SAMEEXP :  a^m *or/ b^m  */
-                // pick integer exponent m
-                Frac mExp;
-                while(true){
-                    Frac cand = exp_pool[ePos(rng)];
-                    if(cand.d==1){ mExp=cand; break; }
+            if(req=="STATS"){
+                out = "OK served=" + std::to_string(served_.load())
+                    + " generated=" + std::to_string(generated_.load()) + " fill=";
+                for(int l=1;l<=corpus::LEVELS;++l){
+                    out += std::to_string(ring_[l].size());
+                    out += l<corpus::LEVELS? ',' : '\n';
                 }
+                return;
+            }
+            out = "ERR expected GET <level> <n> or STATS\n";
+        }
 
-                // pick bases a and b
-                Frac aBase = base_pool[bPos(rng)];
-                if(coin(rng)<0.3) aBase={neg_int_base[bNeg(rng)],1};
-                Frac bBase = base_pool[bPos(rng)];
-                if(coin(rng)<0.3) bBase={neg_int_base[bNeg(rng)],1};
-
-                // decide primary operator (mul/div)
-                bool isMul = (coin(rng)<0.5);
-
-                // decide trap
-                double trapP = 0.1 + (coin(rng)*0.1); // 0.10 to 0.20
-                bool isTrap = (coin(rng) < trapP);
-
-                char opActual;
-                if(!isTrap){ opActual = isMul ? '*' : '/'; }
-                else{ opActual = (coin(rng)<0.5? '+' : '-'); }
-
-                // build term strings with base parentheses handling
-                auto baseStrA = base_to_string(aBase);
-                auto baseStrB = base_to_string(bBase);
-                std::string mStr = std::to_string(mExp.n);
-
-                std::string termA = baseStrA + "^" + mStr;
-                std::string termB = baseStrB + "^" + mStr;
-                expr = termA + " " + opActual + " " + termB;
-
-                // compute difficulty and value
-                double diff_local = 0.0;
-
-                if(!isTrap){
-                    // combine bases first
-                    auto comb = diff_on_fraction(isMul?'*':'/', aBase, bBase);
-                    diff_local += comb.second;
-                    Frac combinedBase = comb.first;
-                    if(!rational_ok(combinedBase,mExp)) continue;
-                    val = pow_frac(combinedBase, mExp);
-                    diff_local += diff_power(combinedBase, mExp);
-                }else{
-                    // trap: evaluate separately then add/sub
-                    if(!rational_ok(aBase,mExp) || !rational_ok(bBase,mExp)) continue;
-                    auto valA = pow_frac(aBase, mExp);
-                    auto valB = pow_frac(bBase, mExp);
-                    diff_local += diff_power(aBase, mExp);
-                    diff_local += diff_power(bBase, mExp);
-                    auto comb = diff_on_fraction(opActual, valA, valB);
-                    diff_local += comb.second;
-                    val = comb.first;
-
-                    // ensure each term magnitude band
-                    double absA=std::fabs(value(valA));
-                    double absB=std::fabs(value(valB));
-                    if(absA<1.0/256.0 || absA>256.0 || absB<1.0/256.0 || absB>256.0) continue;
+        void session(int fd){
+            localsock::LineReader in(fd);
+            std::string req, out;
+            try{
+                while(in.next(req)){
+                    if(!req.empty() && req.back()=='\r') req.pop_back();
+                    handle(req, out);
+                    localsock::send_all(fd, out);
                 }
+            }catch(const std::exception&){}           // client went away
+            ::close(fd);
+        }
 
-                diff_exp_arith = diff_local;   // use variable for later sum
-                E = {-1,1}; // dummy to skip further combine; we set total_diff later
+    public:
+        /* levels with no distinct questions get no ring */
+        QuestionServer(std::size_t buffer, std::chrono::milliseconds wait) : wait_(wait){
+            LevelCounts cap = level_capacity();
+            for(int l=1;l<=corpus::LEVELS;++l)
+                if(cap[l]) ring_[l].reserve(buffer);
+        }
+        ~QuestionServer(){
+            { std::lock_guard<std::mutex> g(wake_m_);  stop_ = true; }
+            wake_.notify_all();
+            for(auto& t: refill_) t.join();
+        }
+
+        void start(std::uint64_t seed, int threads){
+            for(int t=0;t<threads;++t) refill_.emplace_back(&QuestionServer::refill, this, seed, t);
+        }
 
-                // magnitude filter shared later will use val
-                base = {0,1}; // set base dummy so rational_ok not reused later
+        /* block until every ring is full or `limit` passes; the fill
+           reached per level goes to stderr                              */
+        void warm(std::chrono::milliseconds limit){
+            auto until = std::chrono::steady_clock::now() + limit;
+            while(std::chrono::steady_clock::now() < until){
+                double total = 0;
+                for(double x: need()) total += x;
+                if(total==0) break;
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
             }
-    
-            double total_diff;
-            if(E.d!=1 || E.n!= -1){ // normal paths where E meaningful
-                /* choose base for calculation: drop sign if minus is outside */
-                Frac calcBase = base;
-                if(extraMinus && calcBase.n<0) calcBase.n = -calcBase.n;
-
-                /* rational-result + magnitude filter */
-                if(!rational_ok(calcBase,E)) continue;
-                Frac valTmp = pow_frac(calcBase,E);
-                if(extraMinus) valTmp.n *= -1;         // apply outside minus
-                if(std::llabs(valTmp.n) > 256 || valTmp.d > 256) continue;  // enforce small components first
-                double valdbl = std::fabs(value(valTmp));
-                if(valdbl<1.0/256.0 || valdbl>256.0) continue;
-
-                val = valTmp;
-                double diff_atomic = diff_power(calcBase,E);
-                total_diff = diff_exp_arith + diff_atomic;
-            }else{
-                // value & diff already computed in diff_exp_arith branch
-                if(std::llabs(val.n) > 256 || val.d > 256) continue;
-                double valdbl = std::fabs(value(val));
-                if(valdbl<1.0/256.0 || valdbl>256.0) continue;
-                total_diff = diff_exp_arith;
+            std::cerr<<"warm:";
+            for(int l=1;l<=corpus::LEVELS;++l)
+                if(ring_[l].capacity()) std::cerr<<" L"<<l<<"="<<ring_[l].size();
+            std::cerr<<" (of "<<ring_[1].capacity()<<")\n";
+        }
+
+        /* one thread per connection; runs until the process is killed */
+        void serve(const std::string& spec){
+            int lfd = localsock::listen_on(localsock::parse(spec));
+            std::cerr<<"serving on "<<spec<<"\n";
+            while(true){
+                int fd = ::accept(lfd, nullptr, nullptr);
+                if(fd<0){
+                    if(errno==EINTR || errno==ECONNABORTED) continue;
+                    ::close(lfd);
+                    throw std::runtime_error(std::string("accept: ")+std::strerror(errno));
+                }
+                std::thread(&QuestionServer::session, this, fd).detach();
             }
-    
-            return {expr, frac_to_string(val), total_diff};
         }
-    }
+    };
     /*───────────────────────────────────────────────────────────────────*/
-    int main(){
-        constexpr int TARGET = 250'000;
-        int produced = 0;
-        std::unordered_set<std::string> seen;   // O(1) duplicate filter
-
-        while(produced < TARGET){
-            try{
-                Question q = generate_one();
-                if(seen.count(q.expr)) continue;    // skip duplicates
-                seen.insert(q.expr);
-                std::cout << "{\"expression\":\""<<q.expr
-                          << "\",\"answer\":\""<<q.ans
-                          << "\",\"difficulty\":"<<std::fixed<<std::setprecision(2)<<q.difficulty
-                          <<"}\n";
-                ++produced;
-            }catch(const std::length_error &){
-                continue; // skip pathological case and keep generating
+    #ifndef EXPO_GEN_NO_MAIN    // expo_bench.cpp includes this file for its runners
+    int main(int argc, char** argv){
+        long long target = 250'000;
+        std::uint64_t seed = std::random_device{}();
+        int threads = 1;
+        bool enumerate = false;
+        const QuestionFamily* fam = &exponent_family();
+        double fp = 0;              // Bloom false-positive budget, 0 = exact
+        const char* binaryOut = nullptr;
+        const char* outPath = nullptr;
+        int outFd = 1;
+        const char* quotaSpec = nullptr;
+        std::string shardDir = ".";
+        const char* serveSpec = nullptr;
+        const char* rangeSpec = nullptr;
+        const char* levelSpec = nullptr;
+        const char* indexPath = nullptr;
+        LevelMap levels;
+        long long warmup = 1<<16;
+        Proposal proposal = Proposal::UNIFORM;
+        bool seeded = false;
+        long long buffer = 512;     // per-level ring size in --serve mode
+        long long waitMs = 100;
+
+        for(int i=1;i<argc;++i){
+            const char* a = argv[i];
+            if(!std::strcmp(a,"--check-kernels")) return check_kernels();
+            if(!std::strcmp(a,"--enumerate")){ enumerate=true; continue; }
+            const char* v = (i+1<argc)? argv[i+1] : nullptr;
+            if(!v){ std::cerr<<"missing value for "<<a<<"\n"; return 1; }
+            if(!std::strcmp(a,"--count"))        target  = std::atoll(v);
+            else if(!std::strcmp(a,"--seed")){  seed    = std::strtoull(v,nullptr,10);  seeded = true; }
+            else if(!std::strcmp(a,"--threads")) threads = std::atoi(v);
+            else if(!std::strcmp(a,"--dedup-fp")) fp     = std::atof(v);
+            else if(!std::strcmp(a,"--binary-out")) binaryOut = v;
+            else if(!std::strcmp(a,"--out"))     outPath = v;
+            else if(!std::strcmp(a,"--fd"))      outFd   = std::atoi(v);
+            else if(!std::strcmp(a,"--per-level") || !std::strcmp(a,"--level-quota")) quotaSpec = v;
+            else if(!std::strcmp(a,"--shard-dir")) shardDir = v;
+            else if(!std::strcmp(a,"--serve"))   serveSpec = v;
+            else if(!std::strcmp(a,"--buffer"))  buffer  = std::atoll(v);
+            else if(!std::strcmp(a,"--wait-ms")) waitMs  = std::atoll(v);
+            else if(!std::strcmp(a,"--range"))   rangeSpec = v;
+            else if(!std::strcmp(a,"--levels")){
+                if(!levels.parse(levelSpec = v)){ std::cerr<<"bad --levels "<<v<<"\n"; return 1; }
+            }
+            else if(!std::strcmp(a,"--warmup"))  warmup  = std::atoll(v);
+            else if(!std::strcmp(a,"--index"))   indexPath = v;
+            else if(!std::strcmp(a,"--family")){
+                if(!(fam = find_family(v))){ std::cerr<<"unknown family "<<v<<"\n"; return 1; }
+            }
+            else if(!std::strcmp(a,"--proposal")){
+                if(!std::strcmp(v,"uniform"))       proposal = Proposal::UNIFORM;
+                else if(!std::strcmp(v,"adaptive")) proposal = Proposal::ADAPTIVE;
+                else{ std::cerr<<"--proposal wants uniform or adaptive\n"; return 1; }
             }
+            else{ std::cerr<<"unknown option "<<a<<"\n"; return 1; }
+            ++i;
         }
-        return 0;
-    }
-    
-    /*───────────────────────────────────────────────────────────────*/
-    /*  NEW helper: difficulty on fraction arithmetic                */
-    /*───────────────────────────────────────────────────────────────*/
-    std::pair<Frac,double> diff_on_fraction(char op,const Frac& a,const Frac& b){
-        // Ensure denominators positive
-        auto make_pos = [](const Frac& f){ Frac r=f; if(r.d<0){ r.d=-r.d; r.n=-r.n;} return r; };
-        Frac A = make_pos(a); Frac B = make_pos(b);
-
-        if(op=='+' || op=='-'){
-            long long lcd = std::lcm(A.d, B.d);
-            double lcdCost = (lcd==A.d && lcd==B.d)? 0.0 : addition_diff(A.d, B.d);
-
-            long long scaledA = A.n * (lcd / A.d);
-            long long scaledB = B.n * (lcd / B.d);
-
-            long long N;
-            double coreCost;
-            if(op=='+'){
-                N = scaledA + scaledB;
-                coreCost = addition_diff(scaledA, scaledB);
-            }else{ // '-'
-                N = scaledA - scaledB;
-                coreCost = subtraction_diff(scaledA, scaledB);
+        if(threads<1 || target<0){ std::cerr<<"bad --threads / --count\n"; return 1; }
+        if(fp<0 || fp>=1){ std::cerr<<"--dedup-fp must be in [0,1)\n"; return 1; }
+        std::uint64_t rangeFirst = 0, rangeLast = 0;
+        if(rangeSpec){
+            char* end;
+            rangeFirst = std::strtoull(rangeSpec, &end, 10);
+            if(*end!=':' || (rangeLast = std::strtoull(end+1, &end, 10), *end) || rangeLast<rangeFirst){
+                std::cerr<<"--range wants I:J with I <= J\n"; return 1;
             }
+        }
+        if(fam!=&exponent_family() && (enumerate || serveSpec || proposal!=Proposal::UNIFORM)){
+            std::cerr<<"--enumerate, --serve and --proposal are exponent-only\n"; return 1;
+        }
+        if(levelSpec && (quotaSpec || serveSpec)){
+            std::cerr<<"--levels applies to --count, --range and --enumerate\n"; return 1;
+        }
+        if(indexPath && (rangeSpec || quotaSpec || serveSpec)){
+            std::cerr<<"--index applies to --count and --enumerate\n"; return 1;
+        }
+        if(warmup<1){ std::cerr<<"bad --warmup\n"; return 1; }
+        const bool exponent = fam==&exponent_family();
+        if(exponent) fam = &exponent_family(proposal);
+        if(!seeded && !serveSpec) std::cerr<<"seed "<<seed<<"\n";   // so the run can be repeated
+        EXPO_TELEMETRY_SESSION();
+
+        if(serveSpec){
+            if(buffer<1 || waitMs<0){ std::cerr<<"bad --buffer / --wait-ms\n"; return 1; }
+            try{
+                QuestionServer server(buffer, std::chrono::milliseconds(waitMs));
+                server.start(seed, threads);
+                server.warm(std::chrono::seconds(2));
+                server.serve(serveSpec);
+            }catch(const std::exception& e){ std::cerr<<e.what()<<"\n"; return 1; }
+            return 0;
+        }
 
-            long long D = lcd;
-            long long g = std::gcd(std::llabs(N), D);
-            double simpCost = 0.0;
-            if(g>1){
-                simpCost = div_diff(std::llabs(N), g) + div_diff(D, g);
-                N/=g; D/=g;
-            }
-            return { Frac{N,D}, lcdCost + coreCost + simpCost };
+        if(quotaSpec){
+            LevelCounts quota;
+            if(!parse_quota(quotaSpec, quota)){ std::cerr<<"bad quota "<<quotaSpec<<"\n"; return 1; }
+            try{ return run_stratified(shardDir, *fam, quota, seed, fp)? 0 : 1; }
+            catch(const std::exception& e){ std::cerr<<e.what()<<"\n"; return 1; }
         }
 
-        // Multiplication or division
-        Frac B_eff = B;
-        if(op=='/') { std::swap(B_eff.n, B_eff.d); } // invert b
+        Sink sink;
+        levels.warmup = warmup;
+        sink.levels = std::move(levels);
+        try{
+            if(binaryOut) sink.binary = std::make_unique<corpus::Writer>(binaryOut);
+            else if(outPath){
+                int fd = ::open(outPath, O_WRONLY|O_CREAT|O_TRUNC, 0644);
+                if(fd<0) throw std::runtime_error(std::string("cannot open ")+outPath);
+                sink.jsonl = std::make_unique<JsonlWriter>(fd, true);
+            }
+            else sink.jsonl = std::make_unique<JsonlWriter>(outFd);
+        }catch(const std::exception& e){ std::cerr<<e.what()<<"\n"; return 1; }
 
-        // multiply numerators and denominators separately
-        double numCost = mul_diff(std::llabs(A.n), std::llabs(B_eff.n)).second;
-        double denCost = mul_diff(A.d, B_eff.d).second;
+        if(rangeSpec){
+            try{
+                run_range(sink, *fam, rangeFirst, rangeLast, seed, threads);
+                sink.close();
+            }catch(const std::exception& e){ std::cerr<<e.what()<<"\n"; return 1; }
+            return 0;
+        }
 
-        long long N = A.n * B_eff.n;
-        long long D = A.d * B_eff.d;
+        std::unique_ptr<KeyIndex> index;
+        try{ if(indexPath) index = std::make_unique<KeyIndex>(indexPath, fam->name()); }
+        catch(const std::exception& e){ std::cerr<<e.what()<<"\n"; return 1; }
+        const long long indexed = index? index->size() : 0;
+
+        /* dedup can never get past the number of distinct questions */
+        long long capacity = exponent? (long long)enumerate_all().size() - indexed : target;
+        if(!enumerate && target>capacity){
+            std::cerr<<"only "<<capacity<<" distinct questions "<<(index? "are not indexed" : "exist")
+                     <<"; --count lowered from "<<target<<" (see --enumerate)\n";
+            target = capacity;
+        }
 
-        long long g = std::gcd(std::llabs(N), D);
-        double simpCost = 0.0;
-        if(g>1){
-            simpCost = div_diff(std::llabs(N), g) + div_diff(D, g);
-            N/=g; D/=g;
+        /* the index takes the keys only once the output is closed: a run
+           that fails (or is killed) before that leaves it as it was     */
+        long long produced = target;
+        try{
+            if(enumerate) run_enumerated(sink, target, seed, index.get());
+            else produced = run_sharded(sink, *fam, target, seed, threads, fp, index.get());
+            sink.close();
+            if(index) index->commit();
+        }catch(const std::exception& e){ std::cerr<<e.what()<<"\n"; return 1; }
+        if(index){
+            std::cerr<<"index "<<indexPath<<": "<<index->size()<<" questions (+"
+                     <<(long long)index->size() - indexed<<")\n";
+        }
+        if(produced<target){
+            std::cerr<<"wrote "<<produced<<" of "<<target<<": "<<STALL_LIMIT
+                     <<" draws in a row gave no new question"
+                     <<(fp>0? " (--dedup-fp drops some for good)" : "")<<"\n";
+            return 1;
         }
-        return { Frac{N,D}, numCost + denCost + simpCost };
+        return 0;
     }
-    
\ No newline at end of file
+    #endif
@@ -0,0 +1,137 @@
+/*  local_socket.h  ─────────  tiny socket helpers for the question server
+    An endpoint is written "unix:/path/to.sock" or "tcp:PORT" /
+    "tcp:HOST:PORT" (IPv4; HOST defaults to 127.0.0.1).  Functions return
+    a file descriptor or throw std::runtime_error.                       */
+    #pragma once
+    #include <cerrno>
+    #include <cstring>
+    #include <stdexcept>
+    #include <string>
+    #include <string_view>
+    #include <arpa/inet.h>
+    #include <netinet/in.h>
+    #include <netinet/tcp.h>
+    #include <sys/socket.h>
+    #include <sys/stat.h>
+    #include <sys/un.h>
+    #include <unistd.h>
+
+    namespace localsock {
+
+    struct Endpoint{
+        bool unix_domain = false;
+        std::string path;                       // unix
+        std::string host = "127.0.0.1";         // tcp
+        int port = 0;
+    };
+
+    inline Endpoint parse(std::string_view spec){
+        Endpoint ep;
+        if(spec.substr(0,5)=="unix:"){
+            ep.unix_domain = true;
+            ep.path = std::string(spec.substr(5));
+            if(ep.path.empty() || ep.path.size()>=sizeof(sockaddr_un{}.sun_path))
+                throw std::runtime_error("bad unix socket path");
+            return ep;
+        }
+        if(spec.substr(0,4)!="tcp:") throw std::runtime_error("endpoint must start with unix: or tcp:");
+        std::string rest(spec.substr(4));
+        std::size_t colon = rest.rfind(':');
+        if(colon!=std::string::npos){ ep.host = rest.substr(0,colon); rest = rest.substr(colon+1); }
+        ep.port = std::atoi(rest.c_str());
+        if(ep.port<=0 || ep.port>65535) throw std::runtime_error("bad tcp port");
+        return ep;
+    }
+
+    inline void fail(const char* what){
+        throw std::runtime_error(std::string(what) + ": " + std::strerror(errno));
+    }
+
+    /* the whole path or an error: never a truncated one */
+    inline sockaddr_un unix_address(const std::string& path){
+        sockaddr_un a{};  a.sun_family = AF_UNIX;
+        if(path.empty() || path.size()>=sizeof a.sun_path)
+            throw std::runtime_error("unix socket path too long: " + path);
+        std::memcpy(a.sun_path, path.c_str(), path.size()+1);
+        return a;
+    }
+
+    inline int listen_on(const Endpoint& ep){
+        int fd;
+        if(ep.unix_domain){
+            sockaddr_un a = unix_address(ep.path);
+            struct stat st{};                           // a stale socket from a previous run goes,
+            if(::lstat(ep.path.c_str(), &st)==0){       // anything else at the path stays
+                if(!S_ISSOCK(st.st_mode)) throw std::runtime_error(ep.path + " exists and is not a socket");
+                if(::unlink(ep.path.c_str())!=0) fail("unlink");
+            }
+            fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+            if(fd<0) fail("socket");
+            if(::bind(fd, (sockaddr*)&a, sizeof a)!=0){ ::close(fd); fail("bind"); }
+        }else{
+            fd = ::socket(AF_INET, SOCK_STREAM, 0);
+            if(fd<0) fail("socket");
+            int one = 1;
+            ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof one);
+            sockaddr_in a{};  a.sin_family = AF_INET;  a.sin_port = htons(ep.port);
+            if(::inet_pton(AF_INET, ep.host.c_str(), &a.sin_addr)!=1){ ::close(fd); throw std::runtime_error("bad tcp host"); }
+            if(::bind(fd, (sockaddr*)&a, sizeof a)!=0){ ::close(fd); fail("bind"); }
+        }
+        if(::listen(fd, 128)!=0){ ::close(fd); fail("listen"); }
+        return fd;
+    }
+
+    inline int connect_to(const Endpoint& ep){
+        int fd;
+        if(ep.unix_domain){
+            sockaddr_un a = unix_address(ep.path);
+            fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+            if(fd<0) fail("socket");
+            if(::connect(fd, (sockaddr*)&a, sizeof a)!=0){ ::close(fd); fail("connect"); }
+        }else{
+            fd = ::socket(AF_INET, SOCK_STREAM, 0);
+            if(fd<0) fail("socket");
+            sockaddr_in a{};  a.sin_family = AF_INET;  a.sin_port = htons(ep.port);
+            if(::inet_pton(AF_INET, ep.host.c_str(), &a.sin_addr)!=1){ ::close(fd); throw std::runtime_error("bad tcp host"); }
+            if(::connect(fd, (sockaddr*)&a, sizeof a)!=0){ ::close(fd); fail("connect"); }
+            int one = 1;                                // request/response: no Nagle delay
+            ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof one);
+        }
+        return fd;
+    }
+
+    /* whole buffer or throw */
+    inline void send_all(int fd, std::string_view data){
+        while(!data.empty()){
+            ssize_t n = ::send(fd, data.data(), data.size(), MSG_NOSIGNAL);
+            if(n<0){ if(errno==EINTR) continue; fail("send"); }
+            data.remove_prefix(n);
+        }
+    }
+
+    /* buffered line reader over a socket; false on EOF */
+    class LineReader{
+        int fd_;
+        std::string buf_;
+        std::size_t pos_ = 0;
+    public:
+        explicit LineReader(int fd) : fd_(fd) {}
+        bool next(std::string& line){
+            while(true){
+                std::size_t nl = buf_.find('\n', pos_);
+                if(nl!=std::string::npos){
+                    line.assign(buf_, pos_, nl-pos_);
+                    pos_ = nl+1;
+                    return true;
+                }
+                buf_.erase(0, pos_);  pos_ = 0;
+                char chunk[16384];
+                ssize_t n = ::recv(fd_, chunk, sizeof chunk, 0);
+                if(n<0 && errno==EINTR) continue;
+                if(n<=0) return false;
+                buf_.append(chunk, n);
+            }
+        }
+    };
+
+    } // namespace localsock
@@ -0,0 +1,55 @@
+/*  philox.h  ─────────  counter-based random stream (Philox4x32-10)
+    Random123's Philox4x32 with 10 rounds (Salmon et al., SC'11): a
+    keyed bijection on 128-bit counters, so block k of stream s under
+    key K is computed directly, with no state carried between blocks.
+
+      philox::Stream rng(seed, i);   // a UniformRandomBitGenerator
+      generate_one(rng);             // question i, whatever came before
+
+    The key is the seed; the counter is (block, stream).  Each block
+    yields four 32-bit words, handed out as two 64-bit results.         */
+    #pragma once
+    #include <array>
+    #include <cstdint>
+    #include <limits>
+
+    namespace philox {
+
+    using Block = std::array<std::uint32_t,4>;
+
+    constexpr Block block(Block ctr, std::uint64_t key){
+        constexpr std::uint32_t M0 = 0xD2511F53, M1 = 0xCD9E8D57;
+        constexpr std::uint32_t W0 = 0x9E3779B9, W1 = 0xBB67AE85;
+        std::uint32_t k0 = (std::uint32_t)key, k1 = (std::uint32_t)(key>>32);
+        for(int round=0;round<10;++round){
+            std::uint64_t p0 = (std::uint64_t)M0*ctr[0], p1 = (std::uint64_t)M1*ctr[2];
+            ctr = { (std::uint32_t)(p1>>32) ^ ctr[1] ^ k0, (std::uint32_t)p1,
+                    (std::uint32_t)(p0>>32) ^ ctr[3] ^ k1, (std::uint32_t)p0 };
+            k0 += W0;  k1 += W1;
+        }
+        return ctr;
+    }
+
+    class Stream{
+        std::uint64_t key_, stream_, next_ = 0;   // next_: block counter
+        Block buf_{};
+        int pos_ = 4;                             // words used in buf_
+    public:
+        using result_type = std::uint64_t;
+        Stream(std::uint64_t key, std::uint64_t stream) : key_(key), stream_(stream) {}
+
+        static constexpr result_type min(){ return 0; }
+        static constexpr result_type max(){ return std::numeric_limits<result_type>::max(); }
+        result_type operator()(){
+            if(pos_==4){
+                buf_ = block({ (std::uint32_t)next_, (std::uint32_t)(next_>>32),
+                               (std::uint32_t)stream_, (std::uint32_t)(stream_>>32) }, key_);
+                ++next_;  pos_ = 0;
+            }
+            result_type r = (std::uint64_t)buf_[pos_+1]<<32 | buf_[pos_];
+            pos_ += 2;
+            return r;
+        }
+    };
+
+    } // namespace philox
@@ -0,0 +1,103 @@
+/*  quantile_sketch.h  ─────────  streaming quantiles (KLL)
+    Karnin, Lang & Liberty, "Optimal Quantile Approximation in Streams"
+    (FOCS'16).  A stack of compactors: compactor h holds items standing
+    for 2^h inputs each.  When the sketch is over budget, the lowest
+    full compactor is sorted and every other item (odd or even half,
+    by coin flip) moves up one level.  Capacities shrink by 2/3 per
+    level going down, so memory is O(k log(n/k)) and a quantile's rank
+    is off by about 1.7/k of n (k = 200: ±0.85%).
+
+      kll::Sketch s;                     // k = 200
+      for(double d: stream) s.update(d);
+      double median = s.quantile(0.5);
+
+    The coin is a fixed-seed generator, so the same stream always gives
+    the same sketch.                                                    */
+    #pragma once
+    #include <algorithm>
+    #include <cmath>
+    #include <cstddef>
+    #include <cstdint>
+    #include <limits>
+    #include <utility>
+    #include <vector>
+
+    namespace kll {
+
+    class Sketch{
+        static constexpr std::size_t MIN_CAP = 8;
+        int k_;
+        std::vector<std::vector<double>> level_;   // level_[h]: items of weight 2^h
+        std::size_t size_ = 0, budget_ = 0;         // items held, Σ capacities
+        std::uint64_t n_ = 0, coin_ = 0x9E3779B97F4A7C15ULL;
+        double min_ = std::numeric_limits<double>::infinity();
+        double max_ = -std::numeric_limits<double>::infinity();
+
+        std::size_t capacity(std::size_t h) const {
+            double c = k_ * std::pow(2.0/3.0, (double)(level_.size()-1-h));
+            return std::max(MIN_CAP, (std::size_t)std::ceil(c));
+        }
+        void grow(){
+            level_.emplace_back();
+            budget_ = 0;
+            for(std::size_t h=0;h<level_.size();++h) budget_ += capacity(h);
+        }
+        bool flip(){                                // xorshift64
+            coin_ ^= coin_<<13;  coin_ ^= coin_>>7;  coin_ ^= coin_<<17;
+            return coin_ & 1;
+        }
+        /* halve the lowest compactor at capacity; an odd item stays put */
+        void compress(){
+            for(std::size_t h=0;h<level_.size();++h){
+                if(level_[h].size()<capacity(h)) continue;
+                if(h+1==level_.size()) grow();
+                std::vector<double>& v = level_[h];
+                std::sort(v.begin(), v.end());
+                std::size_t pairs = v.size()/2, off = flip();
+                for(std::size_t i=0;i<pairs;++i) level_[h+1].push_back(v[2*i+off]);
+                v.erase(v.begin(), v.begin() + 2*pairs);
+                size_ -= pairs;
+                return;
+            }
+        }
+    public:
+        explicit Sketch(int k = 200) : k_(k) { grow(); }
+
+        void update(double x){
+            level_[0].push_back(x);
+            ++size_;  ++n_;
+            min_ = std::min(min_, x);  max_ = std::max(max_, x);
+            if(size_>=budget_) compress();
+        }
+        std::uint64_t count() const { return n_; }
+        double min() const { return min_; }
+        double max() const { return max_; }
+
+        /* (value, weight) pairs sorted by value; weights sum to count() */
+        std::vector<std::pair<double,std::uint64_t>> sorted() const {
+            std::vector<std::pair<double,std::uint64_t>> v;
+            v.reserve(size_);
+            for(std::size_t h=0;h<level_.size();++h)
+                for(double x: level_[h]) v.emplace_back(x, std::uint64_t(1)<<h);
+            std::sort(v.begin(), v.end());
+            return v;
+        }
+        /* smallest held value with at least phi·count() inputs ≤ it;
+           phis ascending, one sort for all of them                     */
+        std::vector<double> quantiles(const std::vector<double>& phis) const {
+            std::vector<std::pair<double,std::uint64_t>> v = sorted();
+            std::vector<double> out;
+            std::uint64_t seen = 0;
+            std::size_t i = 0;
+            for(double phi: phis){
+                if(v.empty()){ out.push_back(std::nan("")); continue; }
+                double want = phi*(double)n_;
+                while(i+1<v.size() && (double)(seen + v[i].second)<want) seen += v[i++].second;
+                out.push_back(phi<=0? min_ : phi>=1? max_ : v[i].first);
+            }
+            return out;
+        }
+        double quantile(double phi) const { return quantiles({phi}).front(); }
+    };
+
+    } // namespace kll
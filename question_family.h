@@ -0,0 +1,61 @@
+/*  question_family.h  ─────────  pluggable question families for expo_gen
+    A family is everything the runners need from a kind of question:
+    a draw from a seeded engine (--count), question #i of a counter
+    stream (--range), a dedup key, and optionally a direct per-level
+    sampler (--per-level).  Families without one have their levels
+    filled by walking the counter stream.
+
+      exponent     the rational-exponent forms (expo_core.cpp)
+      arithmetic   + - × ÷ chains, ported from question_generator.py
+                   (arith_core.cpp)                                    */
+    #pragma once
+    #include <cstdint>
+    #include <random>
+    #include <stdexcept>
+    #include <string>
+    #include <string_view>
+    #include "expo_core.h"
+
+    class QuestionFamily{
+    public:
+        using Question = expo::detail::Question;
+        using LevelCounts = expo::detail::LevelCounts;
+
+        virtual ~QuestionFamily() = default;
+        virtual const char* name() const = 0;
+        /* one random question from rng */
+        virtual Question draw(std::mt19937_64& rng) const = 0;
+        /* question #index of the counter stream for seed, a pure
+           function of (seed, index)                                    */
+        virtual Question at(std::uint64_t seed, std::uint64_t index) const = 0;
+        /* dedup identity: the same question always gives the same key,
+           in every run and build (--index files keep them), never 0    */
+        virtual std::uint64_t key(const Question& q) const = 0;
+        /* direct per-level sampling, if the family has it; capacity() is
+           then the number of distinct questions per level               */
+        virtual bool samples_levels() const { return false; }
+        virtual Question at_level(std::mt19937_64&, int /*level*/) const {
+            throw std::logic_error(std::string(name()) + " has no level sampler");
+        }
+        virtual LevelCounts capacity() const { return {}; }
+    };
+
+    /* how the exponent family proposes choices: uniformly, rejecting
+       what the filters refuse, or from the accepted set directly
+       (draw_adaptive).  Same questions in distribution, not per seed.  */
+    enum class Proposal{ UNIFORM, ADAPTIVE };
+    const QuestionFamily& exponent_family(Proposal p = Proposal::UNIFORM);
+    const QuestionFamily& arithmetic_family();
+    /* the arithmetic family's scorer and key, for checking a corpus
+       (corpus_verify): quarter points of one step `res op nxt`, the
+       difficulty of a chain of 1..4 steps worth q quarter points (-1
+       for any other length), and the key of an expression              */
+    int arithmetic_step_q(char op, long long res, long long nxt);
+    double arithmetic_difficulty(int q, int steps);
+    std::uint64_t arithmetic_key(std::string_view expr);
+
+    inline const QuestionFamily* find_family(std::string_view name){
+        if(name=="exponent")   return &exponent_family();
+        if(name=="arithmetic") return &arithmetic_family();
+        return nullptr;
+    }
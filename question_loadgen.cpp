@@ -0,0 +1,119 @@
+/*  question_loadgen.cpp  ─────────  load generator for expo_gen --serve
+    compile:  g++ -std=c++20 -O2 -pthread question_loadgen.cpp -o question_loadgen
+    usage:    question_loadgen --connect unix:PATH|tcp:[HOST:]PORT
+                       [--conns C] [--requests R] [--n N] [--levels A-B]
+                       [--warmup W] [--seed S]
+
+    C connections each send R "GET <level> <n>" requests back to back
+    (levels uniform in A..B), after W unmeasured ones.  Every response
+    is read in full; the latency from send to last byte is recorded and
+    the run ends with throughput and p50 / p90 / p99 / max.             */
+    #include "local_socket.h"
+    #include <algorithm>
+    #include <cmath>
+    #include <chrono>
+    #include <cstdio>
+    #include <cstdlib>
+    #include <iostream>
+    #include <random>
+    #include <thread>
+    #include <vector>
+
+    struct ConnResult{
+        std::vector<double> micros;   // one per measured request
+        long long questions = 0;
+        long long short_replies = 0;  // fewer than n questions
+        std::string error;
+    };
+
+    void run_conn(const localsock::Endpoint& ep, int requests, int warmup, int n,
+                  int lo, int hi, std::uint64_t seed, ConnResult& res){
+        try{
+            int fd = localsock::connect_to(ep);
+            localsock::LineReader in(fd);
+            std::mt19937_64 rng(seed);
+            std::uniform_int_distribution<int> pickLevel(lo, hi);
+            std::string line, req;
+            res.micros.reserve(requests);
+
+            for(int i=0;i<warmup+requests;++i){
+                req = "GET " + std::to_string(pickLevel(rng)) + " " + std::to_string(n) + "\n";
+                auto t0 = std::chrono::steady_clock::now();
+                localsock::send_all(fd, req);
+                if(!in.next(line)) throw std::runtime_error("server closed the connection");
+                long long k = 0;
+                if(std::sscanf(line.c_str(), "OK %lld", &k)!=1) throw std::runtime_error("server: " + line);
+                for(long long j=0;j<k;++j)
+                    if(!in.next(line)) throw std::runtime_error("truncated reply");
+                auto t1 = std::chrono::steady_clock::now();
+                if(i<warmup) continue;
+                res.micros.push_back(std::chrono::duration<double, std::micro>(t1-t0).count());
+                res.questions += k;
+                if(k<n) ++res.short_replies;
+            }
+            ::close(fd);
+        }catch(const std::exception& e){ res.error = e.what(); }
+    }
+
+    /* nearest-rank percentile of sorted v */
+    double percentile(const std::vector<double>& v, double p){
+        if(v.empty()) return 0;
+        std::size_t i = (std::size_t)std::ceil(p/100.0 * v.size());
+        return v[std::min(v.size(), std::max<std::size_t>(i,1)) - 1];
+    }
+
+    int main(int argc, char** argv){
+        const char* spec = nullptr;
+        int conns = 4, requests = 10000, n = 10, warmup = 100, lo = 1, hi = 15;
+        std::uint64_t seed = 1;
+        for(int i=1;i+1<argc;i+=2){
+            std::string a = argv[i];
+            const char* v = argv[i+1];
+            if(a=="--connect")       spec     = v;
+            else if(a=="--conns")    conns    = std::atoi(v);
+            else if(a=="--requests") requests = std::atoi(v);
+            else if(a=="--n")        n        = std::atoi(v);
+            else if(a=="--warmup")   warmup   = std::atoi(v);
+            else if(a=="--seed")     seed     = std::strtoull(v,nullptr,10);
+            else if(a=="--levels"){
+                if(std::sscanf(v, "%d-%d", &lo, &hi)!=2) lo = hi = std::atoi(v);
+            }
+            else{ std::cerr<<"unknown option "<<a<<"\n"; return 1; }
+        }
+        if(!spec || (argc-1)%2 || conns<1 || requests<1 || n<1 || warmup<0 || lo<1 || hi<lo){
+            std::cerr<<"usage: question_loadgen --connect unix:PATH|tcp:[HOST:]PORT [--conns C]\n"
+                       "         [--requests R] [--n N] [--levels A-B] [--warmup W] [--seed S]\n";
+            return 1;
+        }
+
+        localsock::Endpoint ep;
+        try{ ep = localsock::parse(spec); }
+        catch(const std::exception& e){ std::cerr<<e.what()<<"\n"; return 1; }
+
+        std::vector<ConnResult> res(conns);
+        std::vector<std::thread> pool;
+        auto t0 = std::chrono::steady_clock::now();
+        for(int c=0;c<conns;++c)
+            pool.emplace_back(run_conn, std::cref(ep), requests, warmup, n, lo, hi, seed+c, std::ref(res[c]));
+        for(auto& t: pool) t.join();
+        double secs = std::chrono::duration<double>(std::chrono::steady_clock::now()-t0).count();
+
+        std::vector<double> all;
+        long long questions = 0, shortReplies = 0;
+        int failed = 0;
+        for(ConnResult& r: res){
+            if(!r.error.empty()){ std::cerr<<"connection failed: "<<r.error<<"\n"; ++failed; }
+            all.insert(all.end(), r.micros.begin(), r.micros.end());
+            questions += r.questions;
+            shortReplies += r.short_replies;
+        }
+        std::sort(all.begin(), all.end());
+
+        std::printf("requests    %zu over %d connections in %.2f s (%.0f req/s, %.0f questions/s)\n",
+                    all.size(), conns, secs, all.size()/secs, questions/secs);
+        std::printf("latency us  p50 %.1f  p90 %.1f  p99 %.1f  max %.1f\n",
+                    percentile(all,50), percentile(all,90), percentile(all,99),
+                    all.empty()? 0.0 : all.back());
+        if(shortReplies) std::printf("short       %lld replies had fewer than %d questions\n", shortReplies, n);
+        return failed? 1 : 0;
+    }